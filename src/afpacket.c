@@ -0,0 +1,198 @@
+#ifdef __linux__
+
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include "afpacket.h"
+
+/** size the ring frames are validated against, TPACKET_V3 packs frames of any size into a block */
+#define AFPACKET_FRAME_SIZE 2048
+
+/** LLDP multicast address, HTIP frames are broadcast but other LLDP agents use this */
+static const uint8_t LLDP_MULTICAST[] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E };
+
+/** ldh [12]; jeq #0x88cc; ret #262144; ret #0 */
+static struct sock_filter lldpFilter[] = {
+	{ 0x28, 0, 0, 0x0000000c },
+	{ 0x15, 0, 1, 0x000088cc },
+	{ 0x06, 0, 0, 0x00040000 },
+	{ 0x06, 0, 0, 0x00000000 }
+};
+
+/** sets up the ring and the filter, the socket does not receive anything before it is bound */
+static int setupSocket(AFPACKET_PTR sock) {
+	int version = TPACKET_V3;
+	struct sock_fprog filter = { sizeof(lldpFilter) / sizeof(lldpFilter[0]),
+			lldpFilter };
+	struct tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = sock->blockSize;
+	req.tp_block_nr = sock->blocks;
+	req.tp_frame_size = AFPACKET_FRAME_SIZE;
+	req.tp_frame_nr = (sock->blockSize / AFPACKET_FRAME_SIZE) * sock->blocks;
+	req.tp_retire_blk_tov = AFPACKET_RETIRE_MS;
+	if (setsockopt(sock->fd, SOL_PACKET, PACKET_VERSION, &version,
+			sizeof(version))
+			|| setsockopt(sock->fd, SOL_SOCKET, SO_ATTACH_FILTER, &filter,
+					sizeof(filter))
+			|| setsockopt(sock->fd, SOL_PACKET, PACKET_RX_RING, &req,
+					sizeof(req))) {
+		return -1;
+	}
+	sock->ring = mmap(NULL, sock->blockSize * sock->blocks,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, sock->fd, 0);
+	if (sock->ring == MAP_FAILED) {
+		//locking may be refused by RLIMIT_MEMLOCK, the ring works without it
+		sock->ring = mmap(NULL, sock->blockSize * sock->blocks,
+				PROT_READ | PROT_WRITE, MAP_SHARED, sock->fd, 0);
+	}
+	if (sock->ring == MAP_FAILED) {
+		sock->ring = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/** binds the socket to the interface, and joins the LLDP multicast group on it */
+static int bindSocket(AFPACKET_PTR sock) {
+	struct sockaddr_ll addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_ifindex = sock->ifindex;
+	if (bind(sock->fd, (struct sockaddr *) &addr, sizeof(addr))) {
+		return -1;
+	}
+	if (sock->ifindex) {
+		struct packet_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = sock->ifindex;
+		mreq.mr_type = PACKET_MR_MULTICAST;
+		mreq.mr_alen = sizeof(LLDP_MULTICAST);
+		memcpy(mreq.mr_address, LLDP_MULTICAST, sizeof(LLDP_MULTICAST));
+		//not fatal, broadcast HTIP frames arrive either way
+		setsockopt(sock->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+				sizeof(mreq));
+	}
+	return 0;
+}
+
+int afpacketOpen(AFPACKET_PTR sock, const char * ifname, size_t blockSize,
+		unsigned blocks) {
+	memset(sock, 0, sizeof(AFPACKET));
+	sock->fd = -1;
+	sock->blockSize = blockSize ? blockSize : AFPACKET_BLOCK_SIZE;
+	sock->blocks = blocks ? blocks : AFPACKET_BLOCKS;
+	if (ifname) {
+		sock->ifindex = if_nametoindex(ifname);
+		if (sock->ifindex == 0) {
+			return -1;
+		}
+	}
+	//protocol 0: nothing is queued until bind(), after the filter is in place
+	sock->fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (sock->fd < 0) {
+		return -1;
+	}
+	if (setupSocket(sock) || bindSocket(sock)) {
+		int error = errno;
+		afpacketClose(sock);
+		errno = error;
+		return -1;
+	}
+	return 0;
+}
+
+/** hands the frames of a block to the handler, AFPACKET_BATCH at a time */
+static int readBlock(struct tpacket_block_desc * block,
+		AFPACKETHANDLER handler, void * context) {
+	FRAMEVIEW frames[AFPACKET_BATCH];
+	size_t count = 0;
+	uint32_t packets = block->hdr.bh1.num_pkts;
+	struct tpacket3_hdr * header = (struct tpacket3_hdr *) ((uint8_t *) block
+			+ block->hdr.bh1.offset_to_first_pkt);
+	for (uint32_t i = 0; i < packets; i++) {
+		frames[count].data = (uint8_t *) header + header->tp_mac;
+		frames[count].length = header->tp_snaplen;
+		if (++count == AFPACKET_BATCH) {
+			handler(context, frames, count);
+			count = 0;
+		}
+		header = (struct tpacket3_hdr *) ((uint8_t *) header
+				+ header->tp_next_offset);
+	}
+	if (count) {
+		handler(context, frames, count);
+	}
+	return packets;
+}
+
+int afpacketPoll(AFPACKET_PTR sock, int timeout, AFPACKETHANDLER handler,
+		void * context) {
+	int frames = 0;
+	struct tpacket_block_desc * block =
+			(struct tpacket_block_desc *) (sock->ring
+					+ (size_t) sock->next * sock->blockSize);
+	if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+			& TP_STATUS_USER)) {
+		struct pollfd pfd = { sock->fd, POLLIN | POLLERR, 0 };
+		if (poll(&pfd, 1, timeout) < 0) {
+			return errno == EINTR ? 0 : -1;
+		}
+	}
+	while (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+			& TP_STATUS_USER) {
+		frames += readBlock(block, handler, context);
+		//give the block back to the kernel
+		__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL,
+				__ATOMIC_RELEASE);
+		sock->next = (sock->next + 1) % sock->blocks;
+		block = (struct tpacket_block_desc *) (sock->ring
+				+ (size_t) sock->next * sock->blockSize);
+	}
+	return frames;
+}
+
+void afpacketToRing(void * context, const FRAMEVIEW * frames, size_t count) {
+	AFPACKETRING_PTR target = context;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (size_t i = 0; i < count; i++) {
+		frameRingPushCopy(target->ring, target->pool, frames[i].data,
+				frames[i].length, (uint32_t) now.tv_sec, target->ifindex);
+	}
+}
+
+int afpacketStats(AFPACKET_PTR sock, uint32_t * packets, uint32_t * drops) {
+	struct tpacket_stats_v3 stats;
+	socklen_t length = sizeof(stats);
+	if (getsockopt(sock->fd, SOL_PACKET, PACKET_STATISTICS, &stats,
+			&length)) {
+		return -1;
+	}
+	*packets = stats.tp_packets;
+	*drops = stats.tp_drops;
+	return 0;
+}
+
+void afpacketClose(AFPACKET_PTR sock) {
+	if (sock->ring) {
+		munmap(sock->ring, sock->blockSize * sock->blocks);
+		sock->ring = NULL;
+	}
+	if (sock->fd >= 0) {
+		close(sock->fd);
+		sock->fd = -1;
+	}
+}
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * \file
+ * \brief Linux AF_PACKET receive backend
+ *
+ * Frames are received through a memory mapped TPACKET_V3 ring. A classic BPF filter attached to the
+ * socket drops everything but the LLDP ethertype (0x88CC) in the kernel, and every ring block is handed
+ * to the handler as one batch of FRAMEVIEWs pointing into the ring, so there is no system call or copy
+ * per frame. The frames can go straight to parseLLDPBatch(), or to setHTIPview() and parseLLDP(). To parse
+ * them in another thread instead, use afpacketToRing() as the handler: it only copies the frames into a
+ * FRAMERING.
+ *
+ * Opening the socket needs CAP_NET_RAW. A veth pair or the loopback interface inside a network namespace
+ * is enough to try it out.
+ */
+#ifndef __AFPACKET_H
+#define __AFPACKET_H
+
+#ifdef __linux__
+
+#include "structs.h"
+#include "framering.h"
+
+/** default size of a ring block, a block is handed to the handler at once */
+#define AFPACKET_BLOCK_SIZE (1 << 20)
+/** default number of ring blocks */
+#define AFPACKET_BLOCKS 8
+/** milliseconds after which the kernel hands over a block that is not full */
+#ifndef AFPACKET_RETIRE_MS
+#define AFPACKET_RETIRE_MS 50
+#endif
+/** most frames passed to the handler in one call */
+#define AFPACKET_BATCH 64
+
+/**
+ * Gets a batch of received frames. The frames point into the ring and are only valid during the call.
+ * @param context the context passed to afpacketPoll()
+ * @param frames the frames, each one starting at the ethernet header
+ * @param count the number of frames
+ */
+typedef void (*AFPACKETHANDLER)(void * context, const FRAMEVIEW * frames,
+		size_t count);
+
+/**
+ * Where afpacketToRing() puts the frames
+ */
+typedef struct {
+	FRAMERING_PTR ring; /*!< the ring the frames are pushed to, the handler is its only producer */
+	PACKETPOOL_PTR pool; /*!< the frames are copied into packets of this pool */
+	int ifindex; /*!< interface index stored in the frame descriptors */
+} AFPACKETRING, *AFPACKETRING_PTR;
+
+/**
+ * A receive socket opened with afpacketOpen()
+ */
+typedef struct {
+	int fd; /*!< the packet socket */
+	uint8_t * ring; /*!< the mapped ring */
+	size_t blockSize; /*!< size of a ring block */
+	unsigned blocks; /*!< number of ring blocks */
+	unsigned next; /*!< index of the next block to be read */
+	int ifindex; /*!< index of the interface, 0 for every interface */
+} AFPACKET, *AFPACKET_PTR;
+
+/**
+ * Opens a receive socket with its ring and LLDP filter
+ * @param sock the socket to initialize
+ * @param ifname the interface to receive from, NULL for every interface
+ * @param blockSize size of a ring block, a multiple of the page size. 0 picks AFPACKET_BLOCK_SIZE
+ * @param blocks number of ring blocks, 0 picks AFPACKET_BLOCKS
+ * @return 0 on success, -1 on failure (errno tells why)
+ */
+int afpacketOpen(AFPACKET_PTR sock, const char * ifname, size_t blockSize,
+		unsigned blocks);
+/**
+ * Hands every block the kernel has filled to the handler. Waits up to timeout milliseconds if none is
+ * ready yet.
+ * @param sock an open socket
+ * @param timeout milliseconds to wait for a block, 0 to return at once, -1 to wait forever
+ * @param handler the function the frames are handed to
+ * @param context passed to the handler
+ * @return the number of frames handed to the handler, -1 if waiting failed
+ */
+int afpacketPoll(AFPACKET_PTR sock, int timeout, AFPACKETHANDLER handler,
+		void * context);
+/**
+ * AFPACKETHANDLER that defers parsing: every frame is copied into a packet of the pool and pushed to the
+ * ring with frameRingPushCopy(). The timestamps are CLOCK_MONOTONIC seconds, the clock of platformNow()
+ * on POSIX. Consume the ring with frameRingIngest() and frameRingReleasePacket().
+ * @param context an AFPACKETRING
+ * @param frames the frames, each one starting at the ethernet header
+ * @param count the number of frames
+ */
+void afpacketToRing(void * context, const FRAMEVIEW * frames, size_t count);
+/**
+ * Reads and resets the counters of the socket
+ * @param sock an open socket
+ * @param packets set to the number of frames that passed the filter
+ * @param drops set to the number of frames dropped because the ring was full
+ * @return 0 on success, -1 on failure
+ */
+int afpacketStats(AFPACKET_PTR sock, uint32_t * packets, uint32_t * drops);
+/**
+ * Unmaps the ring and closes the socket
+ * @param sock the socket to close
+ */
+void afpacketClose(AFPACKET_PTR sock);
+
+#endif
+
+#endif
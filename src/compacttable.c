@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include <string.h>
+#include "compacttable.h"
+#include "neighbors.h"
+#include "packetparse.h"
+
+/** keep the load factor under 3/4 */
+#define NEEDSGROW(table) (((table)->count + 1) * 4 > (table)->capacity * 3)
+
+static size_t slotOf(COMPACTTABLE_PTR table, uint64_t key) {
+	//fibonacci hashing, the top bits are the best mixed
+	return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (table->capacity - 1);
+}
+
+static NEIGHBORHOT_PTR findSlot(COMPACTTABLE_PTR table, uint64_t key) {
+	size_t mask = table->capacity - 1;
+	for (size_t i = slotOf(table, key);; i = (i + 1) & mask) {
+		NEIGHBORHOT_PTR entry = &table->entries[i];
+		if (entry->key == key || entry->key == 0) {
+			return entry;
+		}
+	}
+}
+
+static int growTable(COMPACTTABLE_PTR table) {
+	NEIGHBORHOT_PTR old = table->entries;
+	size_t oldCapacity = table->capacity;
+	NEIGHBORHOT_PTR entries = calloc(oldCapacity * 2, sizeof(NEIGHBORHOT));
+	if (entries == NULL) {
+		return -1;
+	}
+	table->entries = entries;
+	table->capacity = oldCapacity * 2;
+	for (size_t i = 0; i < oldCapacity; i++) {
+		if (old[i].key) {
+			*findSlot(table, old[i].key) = old[i];
+		}
+	}
+	free(old);
+	return 0;
+}
+
+/** frees a cold record that leaves the table, unless it can be kept as the spare */
+static void retireCold(COMPACTTABLE_PTR table, NEIGHBORCOLD_PTR cold) {
+	timerWheelCancel(&table->wheel, &cold->timer);
+	if (table->spare == NULL) {
+		table->spare = cold;
+	} else if (table->spare->capacity < cold->capacity) {
+		//keep the bigger one
+		free(table->spare);
+		table->spare = cold;
+	} else {
+		free(cold);
+	}
+}
+
+/** empties a slot and shifts back the entries of its probe chain */
+static void removeSlot(COMPACTTABLE_PTR table, NEIGHBORHOT_PTR entry) {
+	size_t mask = table->capacity - 1;
+	size_t hole = entry - table->entries;
+	retireCold(table, entry->cold);
+	for (size_t i = (hole + 1) & mask; table->entries[i].key; i = (i + 1) & mask) {
+		size_t home = slotOf(table, table->entries[i].key);
+		//move the entry if its home slot is not between the hole and its position
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			table->entries[hole] = table->entries[i];
+			hole = i;
+		}
+	}
+	memset(&table->entries[hole], 0, sizeof(NEIGHBORHOT));
+	table->count--;
+}
+
+/** gets a cold record that can hold a frame of length bytes, the spare one if it is big enough */
+static NEIGHBORCOLD_PTR takeCold(COMPACTTABLE_PTR table, size_t length) {
+	NEIGHBORCOLD_PTR cold = table->spare;
+	if (cold && cold->capacity >= length) {
+		table->spare = NULL;
+	} else {
+		cold = malloc(sizeof(NEIGHBORCOLD) + length);
+		if (cold == NULL) {
+			return NULL;
+		}
+		cold->capacity = length;
+	}
+	cold->timer.next = NULL;
+	cold->timer.prev = NULL;
+	return cold;
+}
+
+/** stores the location of an INFOPIECE that points into the frame of cold */
+static void keepSpan(NEIGHBORCOLD_PTR cold, COMPACTFIELD field,
+		const uint8_t * info, size_t size) {
+	if (info == NULL) {
+		cold->fields[field].offset = 0;
+		cold->fields[field].length = 0;
+		return;
+	}
+	cold->fields[field].offset = info - cold->frame;
+	cold->fields[field].length = size;
+}
+
+/** fills in the cold record and the flags from a payload parsed from the frame of cold */
+static uint16_t indexCold(NEIGHBORCOLD_PTR cold, HTIPPAYLOAD_PTR htip) {
+	uint16_t flags = NEIGHBOR_FLAG_UPDATED;
+	cold->chasisIdType = htip->chasisId.acount;
+	cold->portIdType = htip->portId.acount;
+	keepSpan(cold, COMPACTFIELD_CHASISID, htip->chasisId.info,
+			htip->chasisId.size);
+	keepSpan(cold, COMPACTFIELD_PORTID, htip->portId.info, htip->portId.size);
+	keepSpan(cold, COMPACTFIELD_PORTDESCRIPTION, htip->portDescription.info,
+			htip->portDescription.size);
+	keepSpan(cold, COMPACTFIELD_DEVICECATEGORY, htip->deviceCategory.info,
+			htip->deviceCategory.size);
+	keepSpan(cold, COMPACTFIELD_MANUFACTURERCODE, htip->manufacturerCode.info,
+			htip->manufacturerCode.size);
+	keepSpan(cold, COMPACTFIELD_MODELNAME, htip->modelName.info,
+			htip->modelName.size);
+	keepSpan(cold, COMPACTFIELD_MODELNUMBER, htip->modelNumber.info,
+			htip->modelNumber.size);
+	keepSpan(cold, COMPACTFIELD_MACS, htip->macs.info,
+			(size_t) htip->macs.acount * 6);
+	if (htip->deviceCategory.info || htip->manufacturerCode.info
+			|| htip->modelName.info || htip->modelNumber.info) {
+		flags |= NEIGHBOR_FLAG_DEVICEINFO;
+	}
+	if (htip->portCount) {
+		flags |= NEIGHBOR_FLAG_FORWARDING;
+	}
+	if (htip->connectivityCount) {
+		flags |= NEIGHBOR_FLAG_CONNECTIVITY;
+	}
+	return flags;
+}
+
+COMPACTTABLE_PTR createCompactTable(size_t capacity) {
+	COMPACTTABLE_PTR table = malloc(sizeof(COMPACTTABLE));
+	if (table == NULL) {
+		return NULL;
+	}
+	table->capacity = 16;
+	while (table->capacity * 3 < capacity * 4) {
+		table->capacity *= 2;
+	}
+	table->count = 0;
+	table->expired = 0;
+	table->spare = NULL;
+	//the first compactExpire() catches the wheel up with whatever clock is used
+	timerWheelInit(&table->wheel, 0);
+	table->entries = calloc(table->capacity, sizeof(NEIGHBORHOT));
+	table->scratch = calloc(1, sizeof(HTIPPAYLOAD));
+	if (table->entries == NULL || table->scratch == NULL) {
+		free(table->entries);
+		free(table->scratch);
+		free(table);
+		return NULL;
+	}
+	return table;
+}
+
+void destroyCompactTable(COMPACTTABLE_PTR table) {
+	if (table == NULL) {
+		return;
+	}
+	for (size_t i = 0; i < table->capacity; i++) {
+		if (table->entries[i].key) {
+			free(table->entries[i].cold);
+		}
+	}
+	free(table->spare);
+	freeHTIP(table->scratch);
+	free(table->entries);
+	free(table);
+}
+
+NEIGHBORHOT_PTR compactIngest(COMPACTTABLE_PTR table, const uint8_t * frame,
+		size_t length, uint32_t now) {
+	if (length < sizeof(ETHHEADER) || length > UINT16_MAX) {
+		return NULL;
+	}
+	ETHHEADER_PTR header = (ETHHEADER_PTR) frame;
+	uint64_t key = macToKey(header->SRC);
+	NEIGHBORHOT_PTR entry = findSlot(table, key);
+	uint64_t fingerprint = fingerprintFrame(frame, length);
+	if (entry->key && entry->fingerprint == fingerprint
+			&& entry->cold->length == length) {
+		//same advertisement as last time, just refresh it
+		entry->recvTime = now;
+		timerWheelSchedule(&table->wheel, &entry->cold->timer, now + entry->ttl);
+		return entry;
+	}
+	NEIGHBORCOLD_PTR cold = takeCold(table, length);
+	if (cold == NULL) {
+		return NULL;
+	}
+	memcpy(cold->frame, frame, length);
+	cold->length = length;
+	HTIPPAYLOAD_PTR htip = table->scratch;
+	resetHTIP(htip);
+	setHTIPview(htip, length, cold->frame);
+	parseLLDP(htip, NULL, 0);
+	if (htip->parseResult.acount != 1 || htip->ttl.acount == 0) {
+		if (htip->parseResult.acount == 1 && entry->key) {
+			//LLDP shutdown frame, the neighbor is leaving
+			removeSlot(table, entry);
+		}
+		retireCold(table, cold);
+		return NULL;
+	}
+	uint16_t flags = indexCold(cold, htip);
+	if (entry->key == 0) {
+		if (NEEDSGROW(table) && growTable(table)) {
+			retireCold(table, cold);
+			return NULL;
+		}
+		entry = findSlot(table, key);
+		entry->key = key;
+		table->count++;
+	} else {
+		retireCold(table, entry->cold);
+	}
+	cold->timer.key = key;
+	entry->cold = cold;
+	entry->fingerprint = fingerprint;
+	entry->recvTime = now;
+	entry->ttl = htip->ttl.acount;
+	entry->flags = flags;
+	timerWheelSchedule(&table->wheel, &cold->timer, now + entry->ttl);
+	return entry;
+}
+
+NEIGHBORHOT_PTR compactFind(COMPACTTABLE_PTR table, const uint8_t * mac) {
+	NEIGHBORHOT_PTR entry = findSlot(table, macToKey(mac));
+	return entry->key ? entry : NULL;
+}
+
+void compactMac(NEIGHBORHOT_PTR hot, uint8_t * mac) {
+	for (int i = 5; i >= 0; i--) {
+		mac[i] = (uint8_t) (hot->key >> (8 * (5 - i)));
+	}
+}
+
+const uint8_t * compactField(NEIGHBORHOT_PTR hot, COMPACTFIELD field,
+		size_t * length) {
+	NEIGHBORSPAN span = hot->cold->fields[field];
+	*length = span.length;
+	return span.offset ? &hot->cold->frame[span.offset] : NULL;
+}
+
+HTIPPAYLOAD_PTR compactToHTIP(NEIGHBORHOT_PTR hot, HTIPPAYLOAD_PTR htip) {
+	setHTIPview(htip, hot->cold->length, hot->cold->frame);
+	htip->recvTime = hot->recvTime;
+	return parseLLDP(htip, NULL, 0);
+}
+
+int compactRemove(COMPACTTABLE_PTR table, const uint8_t * mac) {
+	NEIGHBORHOT_PTR entry = findSlot(table, macToKey(mac));
+	if (entry->key == 0) {
+		return 0;
+	}
+	removeSlot(table, entry);
+	return 1;
+}
+
+/** timer wheel callback, removes the neighbors of the expired timers */
+static void expireNeighbors(void * context, TIMERNODE_PTR * expired,
+		size_t count) {
+	COMPACTTABLE_PTR table = context;
+	for (size_t i = 0; i < count; i++) {
+		NEIGHBORHOT_PTR entry = findSlot(table, expired[i]->key);
+		if (entry->key && &entry->cold->timer == expired[i]) {
+			removeSlot(table, entry);
+			table->expired++;
+		}
+	}
+}
+
+size_t compactExpire(COMPACTTABLE_PTR table, uint32_t now) {
+	table->expired = 0;
+	timerWheelAdvance(&table->wheel, now, expireNeighbors, table);
+	return table->expired;
+}
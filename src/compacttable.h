@@ -0,0 +1,168 @@
+/**
+ * \file
+ * \brief compact neighbor table for collectors that keep a very large number of neighbors
+ *
+ * Works like the neighbor table of neighbors.h but does not keep an HTIPPAYLOAD per neighbor. The table
+ * itself is an array of 32-byte hot records (mac address, TTL, receive time, flags), two to a cache line,
+ * so lookups, refreshes and expiry scans never leave it. Everything else lives in one cold allocation per
+ * neighbor: the retained frame, 16-bit offset/length pairs of the descriptive fields inside it, and the
+ * expiry timer. A neighbor costs about the size of its frame plus 100 bytes.
+ *
+ * The complete payload of a neighbor (forwarding table, extended connectivity) can still be had by
+ * parsing the retained frame again, see compactToHTIP().
+ */
+#ifndef __COMPACT_TABLE_H
+#define __COMPACT_TABLE_H
+
+#include "structs.h"
+#include "timerwheel.h"
+
+/** the frame changed since the flag was last cleared, the table only ever sets it */
+#define NEIGHBOR_FLAG_UPDATED 0x01
+/** the frame has HTIP device information (category, manufacturer or model) */
+#define NEIGHBOR_FLAG_DEVICEINFO 0x02
+/** the frame has an HTIP mac forwarding table */
+#define NEIGHBOR_FLAG_FORWARDING 0x04
+/** the frame has HTIP extended connectivity information */
+#define NEIGHBOR_FLAG_CONNECTIVITY 0x08
+
+/**
+ * The descriptive fields kept for every neighbor, see compactField()
+ */
+typedef enum {
+	COMPACTFIELD_CHASISID = 0, /*!< LLDP chasis id */
+	COMPACTFIELD_PORTID, /*!< LLDP port id */
+	COMPACTFIELD_PORTDESCRIPTION, /*!< LLDP port description */
+	COMPACTFIELD_DEVICECATEGORY, /*!< HTIP device category */
+	COMPACTFIELD_MANUFACTURERCODE, /*!< HTIP manufacturer code */
+	COMPACTFIELD_MODELNAME, /*!< HTIP model name */
+	COMPACTFIELD_MODELNUMBER, /*!< HTIP model number */
+	COMPACTFIELD_MACS, /*!< HTIP bridge mac addresses, 6 bytes each */
+	COMPACTFIELD_COUNT
+} COMPACTFIELD;
+
+/**
+ * Location of a field inside NEIGHBORCOLD::frame, offset is 0 if the field was absent
+ */
+typedef struct {
+	uint16_t offset; /*!< offset of the field in the frame */
+	uint16_t length; /*!< length of the field */
+} NEIGHBORSPAN;
+
+/**
+ * The cold part of a neighbor, only read when its fields are asked for
+ */
+typedef struct {
+	TIMERNODE timer; /*!< expiry timer, its key is the key of the neighbor */
+	NEIGHBORSPAN fields[COMPACTFIELD_COUNT]; /*!< the kept fields, indexed by COMPACTFIELD */
+	uint8_t chasisIdType; /*!< LLDP chasis id subtype */
+	uint8_t portIdType; /*!< LLDP port id subtype */
+	uint16_t length; /*!< length of the frame */
+	uint16_t capacity; /*!< bytes allocated for the frame */
+	uint8_t frame[]; /*!< the retained frame, starting at the ethernet header */
+} NEIGHBORCOLD, *NEIGHBORCOLD_PTR;
+
+/**
+ * The hot part of a neighbor, kept in the table itself
+ */
+typedef struct {
+	uint64_t key; /*!< source mac address packed by macToKey(), 0 marks an empty slot */
+	uint64_t fingerprint; /*!< fingerprintFrame() of the retained frame */
+	NEIGHBORCOLD_PTR cold; /*!< the rest of the neighbor, owned by the table */
+	uint32_t recvTime; /*!< time the frame was last received, in SECONDS */
+	uint16_t ttl; /*!< LLDP Time To Live, the neighbor expires at recvTime + ttl */
+	uint16_t flags; /*!< NEIGHBOR_FLAG_* bits */
+} NEIGHBORHOT, *NEIGHBORHOT_PTR;
+
+/**
+ * The compact table. Use createCompactTable() to create one.
+ */
+typedef struct {
+	NEIGHBORHOT_PTR entries; /*!< the slots of the table */
+	size_t capacity; /*!< number of slots, always a power of two */
+	size_t count; /*!< number of neighbors in the table */
+	size_t expired; /*!< number of neighbors removed by the last compactExpire() */
+	TIMERWHEEL wheel; /*!< expiry timers of all neighbors */
+	NEIGHBORCOLD_PTR spare; /*!< a cold record that left the table, reused by the next compactIngest() */
+	HTIPPAYLOAD_PTR scratch; /*!< payload the frames are parsed into before they are stored */
+} COMPACTTABLE, *COMPACTTABLE_PTR;
+
+/**
+ * Creates an empty compact table
+ * @param capacity the expected number of neighbors, the table grows when needed
+ * @return the table, or NULL if an allocation failed
+ */
+COMPACTTABLE_PTR createCompactTable(size_t capacity);
+
+/**
+ * Frees the table along with every neighbor in it
+ * @param table the table to free
+ */
+void destroyCompactTable(COMPACTTABLE_PTR table);
+
+/**
+ * Ingests a raw frame, as neighborIngest() does. A re-advertisement with the same fingerprint only
+ * refreshes the receive time. Otherwise the frame is copied into a cold record, checked with parseLLDP()
+ * and its fields are indexed. Frames that don't parse are dropped and a TTL of 0 removes the neighbor.
+ * @param table the compact table
+ * @param frame the frame, starting with the ethernet header
+ * @param length the length of the frame
+ * @param now the current time, in SECONDS
+ * @return the hot record of the source, valid until the table is changed, or NULL if the frame was
+ * not stored
+ */
+NEIGHBORHOT_PTR compactIngest(COMPACTTABLE_PTR table, const uint8_t * frame,
+		size_t length, uint32_t now);
+
+/**
+ * Looks up a neighbor
+ * @param table the compact table
+ * @param mac the source mac address of the neighbor
+ * @return the hot record of the neighbor, valid until the table is changed, or NULL if it is not known
+ */
+NEIGHBORHOT_PTR compactFind(COMPACTTABLE_PTR table, const uint8_t * mac);
+
+/**
+ * Gets the mac address of a neighbor
+ * @param hot the neighbor
+ * @param mac filled in with the 6-byte mac address
+ */
+void compactMac(NEIGHBORHOT_PTR hot, uint8_t * mac);
+
+/**
+ * Gets a descriptive field of a neighbor
+ * @param hot the neighbor
+ * @param field the field to get
+ * @param length set to the length of the field
+ * @return the field inside the retained frame, or NULL if the neighbor doesn't have it
+ */
+const uint8_t * compactField(NEIGHBORHOT_PTR hot, COMPACTFIELD field,
+		size_t * length);
+
+/**
+ * Parses the retained frame of a neighbor into a payload, for the fields the compact record doesn't keep
+ * or to print it. The payload borrows the frame, it is valid until the neighbor changes. Parsing still
+ * allocates, so reuse the payload with resetHTIP() and release it with releaseHTIP() or freeHTIP().
+ * @param hot the neighbor
+ * @param htip a payload zeroed before its first use, or reset with resetHTIP()
+ * @return htip
+ */
+HTIPPAYLOAD_PTR compactToHTIP(NEIGHBORHOT_PTR hot, HTIPPAYLOAD_PTR htip);
+
+/**
+ * Removes a neighbor
+ * @param table the compact table
+ * @param mac the source mac address of the neighbor
+ * @return 1 if the neighbor was removed, 0 if it was not known
+ */
+int compactRemove(COMPACTTABLE_PTR table, const uint8_t * mac);
+
+/**
+ * Removes every neighbor whose TTL has passed
+ * @param table the compact table
+ * @param now the current time, in SECONDS, on the same clock as recvTime
+ * @return the number of neighbors removed
+ */
+size_t compactExpire(COMPACTTABLE_PTR table, uint32_t now);
+
+#endif
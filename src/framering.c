@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include <string.h>
+#include "framering.h"
+
+#ifndef __STDC_NO_ATOMICS__
+#define LOAD_OWN(index) atomic_load_explicit(&(index), memory_order_relaxed)
+#define LOAD_OTHER(index) atomic_load_explicit(&(index), memory_order_acquire)
+#define PUBLISH(index, value) atomic_store_explicit(&(index), (value), memory_order_release)
+#else
+#define LOAD_OWN(index) (index)
+#define LOAD_OTHER(index) (index)
+#define PUBLISH(index, value) ((index) = (value))
+#endif
+
+FRAMERING_PTR createFrameRing(size_t capacity) {
+	size_t slots = 2;
+	while (slots < capacity) {
+		slots <<= 1;
+	}
+	FRAMERING_PTR ring = malloc(sizeof(FRAMERING));
+	if (ring == NULL) {
+		return NULL;
+	}
+	memset(ring, 0, sizeof(FRAMERING));
+	ring->slots = malloc(slots * sizeof(FRAMEDESC));
+	if (ring->slots == NULL) {
+		free(ring);
+		return NULL;
+	}
+	ring->mask = slots - 1;
+	return ring;
+}
+
+void destroyFrameRing(FRAMERING_PTR ring) {
+	if (ring) {
+		free(ring->slots);
+		free(ring);
+	}
+}
+
+int frameRingPush(FRAMERING_PTR ring, const FRAMEDESC * frame) {
+#ifdef __STDC_NO_ATOMICS__
+	FRAMERING_LOCK();
+#endif
+	size_t head = LOAD_OWN(ring->head);
+	if (head - ring->tailCache > ring->mask) {
+		//looks full, check where the consumer really is
+		ring->tailCache = LOAD_OTHER(ring->tail);
+		if (head - ring->tailCache > ring->mask) {
+			ring->dropped++;
+#ifdef __STDC_NO_ATOMICS__
+			FRAMERING_UNLOCK();
+#endif
+			return -1;
+		}
+	}
+	ring->slots[head & ring->mask] = *frame;
+	PUBLISH(ring->head, head + 1);
+#ifdef __STDC_NO_ATOMICS__
+	FRAMERING_UNLOCK();
+#endif
+	return 0;
+}
+
+int frameRingPushCopy(FRAMERING_PTR ring, PACKETPOOL_PTR pool,
+		const uint8_t * data, size_t length, uint32_t timestamp, int ifindex) {
+	PACKET_PTR packet = poolAcquire(pool);
+	if (packet == NULL || length > packet->control.allocated) {
+		if (packet) {
+			poolRelease(pool, packet);
+		}
+		//producer side, same as a full ring
+		ring->dropped++;
+		return -1;
+	}
+	memcpy(packet->data, data, length);
+	packet->control.dataoffset = length;
+	FRAMEDESC frame = { packet->data, length, timestamp, ifindex, packet };
+	if (frameRingPush(ring, &frame)) {
+		poolRelease(pool, packet);
+		return -1;
+	}
+	return 0;
+}
+
+void frameRingReleasePacket(void * context, FRAMEDESC_PTR frame) {
+	poolRelease(context, frame->handle);
+}
+
+size_t frameRingPop(FRAMERING_PTR ring, FRAMEDESC * frames, size_t max) {
+#ifdef __STDC_NO_ATOMICS__
+	FRAMERING_LOCK();
+#endif
+	size_t tail = LOAD_OWN(ring->tail);
+	size_t available = ring->headCache - tail;
+	if (available < max) {
+		//not enough seen yet, check where the producer really is
+		ring->headCache = LOAD_OTHER(ring->head);
+		available = ring->headCache - tail;
+	}
+	if (available > max) {
+		available = max;
+	}
+	for (size_t i = 0; i < available; i++) {
+		frames[i] = ring->slots[(tail + i) & ring->mask];
+	}
+	//one store for the whole batch
+	PUBLISH(ring->tail, tail + available);
+#ifdef __STDC_NO_ATOMICS__
+	FRAMERING_UNLOCK();
+#endif
+	return available;
+}
+
+size_t frameRingIngest(FRAMERING_PTR ring, NEIGHBORTABLE_PTR table,
+		FRAMERELEASE release, void * context) {
+	FRAMEDESC frames[FRAMERING_BATCH];
+	size_t total = 0;
+	size_t count;
+	while ((count = frameRingPop(ring, frames, FRAMERING_BATCH)) > 0) {
+		for (size_t i = 0; i < count; i++) {
+			neighborIngest(table, frames[i].data, frames[i].length,
+					frames[i].timestamp);
+			if (release) {
+				release(context, &frames[i]);
+			}
+		}
+		total += count;
+	}
+	return total;
+}
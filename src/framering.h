@@ -0,0 +1,143 @@
+/**
+ * \file
+ * \brief bounded single-producer/single-consumer ring of received frames
+ *
+ * Decouples the receive path from parsing. The receive context only pushes frame descriptors; a separate
+ * task pops them in batches and parses them, for example with frameRingIngest(). When the parse task falls
+ * behind the ring fills up and new frames are dropped (and counted) instead of stalling the receive path.
+ * Both receive paths can feed a ring: htipInputDefer() for the lwIP input hook, afpacketToRing() as the
+ * AF_PACKET handler.
+ *
+ * The ring does not own the frames. The producer copies a frame into a packet taken from a PACKETPOOL and
+ * pushes it with the packet as handle (see frameRingPushCopy()), the consumer gives the packet back after
+ * parsing (see frameRingReleasePacket()).
+ *
+ * The indices are C11 atomics, each on its own cache line, so one producer and one consumer never take
+ * a lock. Without atomics (__STDC_NO_ATOMICS__ defined) define FRAMERING_LOCK() and FRAMERING_UNLOCK()
+ * (e.g. to taskENTER_CRITICAL()/taskEXIT_CRITICAL()).
+ */
+#ifndef __FRAMERING_H
+#define __FRAMERING_H
+
+#include "structs.h"
+#include "neighbors.h"
+#include "packetpool.h"
+
+#ifndef __STDC_NO_ATOMICS__
+#include <stdatomic.h>
+/** a ring index, only ever written by one side */
+typedef _Atomic size_t RINGINDEX;
+#else
+typedef volatile size_t RINGINDEX;
+#ifndef FRAMERING_LOCK
+#define FRAMERING_LOCK()
+#define FRAMERING_UNLOCK()
+#endif
+#endif
+
+/** size of a cache line, the producer and consumer indices are kept this far apart */
+#ifndef FRAMERING_CACHELINE
+#define FRAMERING_CACHELINE 64
+#endif
+
+/** most frames frameRingIngest() pops at once */
+#define FRAMERING_BATCH 32
+
+/**
+ * A received frame
+ */
+typedef struct {
+	const uint8_t * data; /*!< the frame, starting at the ethernet header */
+	size_t length; /*!< length of the frame */
+	uint32_t timestamp; /*!< receive time in SECONDS, on the clock of HTIPPAYLOAD::recvTime */
+	int ifindex; /*!< interface the frame was received on */
+	void * handle; /*!< owner of the buffer (a pooled PACKET, a pbuf), given back to the release function */
+} FRAMEDESC, *FRAMEDESC_PTR;
+
+/**
+ * Gives the buffer of a consumed frame back to its owner
+ * @param context the context passed to frameRingIngest()
+ * @param frame the consumed frame
+ */
+typedef void (*FRAMERELEASE)(void * context, FRAMEDESC_PTR frame);
+
+/**
+ * The ring, created with createFrameRing()
+ */
+typedef struct {
+	FRAMEDESC_PTR slots; /*!< the descriptors */
+	size_t mask; /*!< number of slots minus one, the number of slots is a power of two */
+	uint8_t producerPad[FRAMERING_CACHELINE];
+	RINGINDEX head; /*!< next slot the producer writes, written by the producer only */
+	size_t tailCache; /*!< last tail the producer has seen */
+	size_t dropped; /*!< number of frames dropped because the ring was full */
+	uint8_t consumerPad[FRAMERING_CACHELINE];
+	RINGINDEX tail; /*!< next slot the consumer reads, written by the consumer only */
+	size_t headCache; /*!< last head the consumer has seen */
+	uint8_t endPad[FRAMERING_CACHELINE];
+} FRAMERING, *FRAMERING_PTR;
+
+/**
+ * Creates an empty ring
+ * @param capacity the number of frames the ring holds, rounded up to a power of two
+ * @return the ring, or NULL if the allocation failed
+ */
+FRAMERING_PTR createFrameRing(size_t capacity);
+
+/**
+ * Frees a ring. Frames still in it are not released.
+ * @param ring the ring to free
+ */
+void destroyFrameRing(FRAMERING_PTR ring);
+
+/**
+ * Adds a frame to the ring. Producer side only.
+ * @param ring the ring
+ * @param frame the frame, the descriptor is copied
+ * @return 0 on success, -1 if the ring is full (the frame is counted in dropped and stays with the caller)
+ */
+int frameRingPush(FRAMERING_PTR ring, const FRAMEDESC * frame);
+
+/**
+ * Copies a frame into a packet of pool and pushes it, with the packet as handle. Producer side only.
+ * @param ring the ring
+ * @param pool the pool the packet is taken from
+ * @param data the frame, starting at the ethernet header
+ * @param length the length of the frame
+ * @param timestamp receive time in SECONDS, on the clock of HTIPPAYLOAD::recvTime
+ * @param ifindex interface the frame was received on
+ * @return 0 on success, -1 if the frame was dropped (counted in dropped): the pool is empty, the frame
+ * doesn't fit in a packet or the ring is full
+ */
+int frameRingPushCopy(FRAMERING_PTR ring, PACKETPOOL_PTR pool,
+		const uint8_t * data, size_t length, uint32_t timestamp, int ifindex);
+
+/**
+ * FRAMERELEASE of the frames pushed with frameRingPushCopy(), gives the packet back to its pool
+ * @param context the pool of the packets
+ * @param frame the consumed frame
+ */
+void frameRingReleasePacket(void * context, FRAMEDESC_PTR frame);
+
+/**
+ * Takes up to max frames out of the ring. Consumer side only.
+ * @param ring the ring
+ * @param frames filled in with the frames, oldest first
+ * @param max the size of the frames array
+ * @return the number of frames taken
+ */
+size_t frameRingPop(FRAMERING_PTR ring, FRAMEDESC * frames, size_t max);
+
+/**
+ * Pops every frame in the ring, stores it in a neighbor table with neighborIngest() and releases it.
+ * Consumer side only.
+ * @param ring the ring
+ * @param table the neighbor table to store the frames in
+ * @param release gives every frame back to its owner, may be NULL
+ * @param context passed to release
+ * @return the number of frames consumed
+ */
+size_t frameRingIngest(FRAMERING_PTR ring, NEIGHBORTABLE_PTR table,
+		FRAMERELEASE release, void * context);
+
+#endif
@@ -0,0 +1,314 @@
+#include <string.h>
+#include "htipbinary.h"
+#include "packetbuild.h"
+
+/**
+ * Output of the encoder. Without a packet the encoder only measures, which is how the length
+ * prefixes are computed before the data itself is written.
+ */
+typedef struct {
+	PACKET_PTR out;
+	size_t size;
+} ENCODER;
+
+static void putBytes(ENCODER * encoder, const uint8_t * data, size_t length) {
+	if (encoder->out && length) {
+		pPokeMany(encoder->out, data, length);
+	}
+	encoder->size += length;
+}
+
+static void putVarint(ENCODER * encoder, uint32_t value) {
+	uint8_t bytes[5];
+	size_t length = 0;
+	while (value >= 0x80) {
+		bytes[length++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	bytes[length++] = value;
+	putBytes(encoder, bytes, length);
+}
+
+static size_t varintSize(uint32_t value) {
+	size_t length = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		length++;
+	}
+	return length;
+}
+
+static void putSection(ENCODER * encoder, uint8_t tag, uint32_t acount,
+		const uint8_t * data, size_t length) {
+	if (data == NULL) {
+		return;
+	}
+	putBytes(encoder, &tag, 1);
+	putVarint(encoder, varintSize(acount) + length);
+	putVarint(encoder, acount);
+	putBytes(encoder, data, length);
+}
+
+/** byte length of a list of length-prefixed extended mac addresses */
+static size_t extMacsLength(INFOPIECE_PTR extMacs) {
+	const uint8_t * entry = extMacs->info - 1;
+	for (uint32_t i = 0; i < extMacs->acount; i++) {
+		entry += 1 + entry[0];
+	}
+	return entry - (extMacs->info - 1);
+}
+
+static void putPort(ENCODER * encoder, MACFTLV_PTR port) {
+	uint8_t lengths = (port->ifLength << 4) | (port->portLength & 0x0F);
+	putBytes(encoder, &lengths, 1);
+	putVarint(encoder, port->ifType);
+	putVarint(encoder, port->portNumber);
+	putVarint(encoder, port->macLength);
+	putBytes(encoder, port->macs, (size_t) port->macLength * 6);
+}
+
+static void putForwardingTable(ENCODER * encoder, HTIPPAYLOAD_PTR htip) {
+	uint32_t ports = htip->portCount;
+	ENCODER measure = { NULL, 0 };
+	for (uint32_t i = 0; i < ports; i++) {
+		putPort(&measure, &htip->macftlvs[i]);
+	}
+	if (ports == 0) {
+		return;
+	}
+	uint8_t tag = HTIPSECTION_FORWARDINGTABLE;
+	putBytes(encoder, &tag, 1);
+	putVarint(encoder, varintSize(ports) + measure.size);
+	putVarint(encoder, ports);
+	for (uint32_t i = 0; i < ports; i++) {
+		putPort(encoder, &htip->macftlvs[i]);
+	}
+}
+
+static void putBody(ENCODER * encoder, HTIPPAYLOAD_PTR htip) {
+	const uint8_t noSource[6] = { 0 };
+	uint8_t version = HTIPBINARY_VERSION;
+	uint8_t parseResult = htip->parseResult.acount;
+	putBytes(encoder, &version, 1);
+	putBytes(encoder, htip->src.info ? htip->src.info : noSource, 6);
+	putVarint(encoder, htip->recvTime);
+	putVarint(encoder, htip->ttl.acount);
+	putBytes(encoder, &parseResult, 1);
+	putSection(encoder, HTIPSECTION_CHASISID, htip->chasisId.acount,
+			htip->chasisId.info, htip->chasisId.size);
+	putSection(encoder, HTIPSECTION_PORTID, htip->portId.acount,
+			htip->portId.info, htip->portId.size);
+	putSection(encoder, HTIPSECTION_PORTDESCRIPTION, 0,
+			htip->portDescription.info, htip->portDescription.size);
+	putSection(encoder, HTIPSECTION_DEVICECATEGORY, 0,
+			htip->deviceCategory.info, htip->deviceCategory.size);
+	putSection(encoder, HTIPSECTION_MANUFACTURERCODE, 0,
+			htip->manufacturerCode.info, htip->manufacturerCode.size);
+	putSection(encoder, HTIPSECTION_MODELNAME, 0, htip->modelName.info,
+			htip->modelName.size);
+	putSection(encoder, HTIPSECTION_MODELNUMBER, 0, htip->modelNumber.info,
+			htip->modelNumber.size);
+	putSection(encoder, HTIPSECTION_MACS, htip->macs.acount, htip->macs.info,
+			(size_t) htip->macs.acount * 6);
+	if (htip->extMacs.info) {
+		putSection(encoder, HTIPSECTION_EXTMACS, htip->extMacs.acount,
+				htip->extMacs.info - 1, extMacsLength(&htip->extMacs));
+	}
+	//one section per port, in frame order
+	for (size_t i = 0; i < htip->connectivityCount; i++) {
+		INFOPIECE_PTR raw = &htip->connectivity[i].raw;
+		putSection(encoder, HTIPSECTION_EXTCONNECTIVITY, raw->acount,
+				raw->info, raw->size);
+	}
+	putForwardingTable(encoder, htip);
+}
+
+size_t encodeHTIP(HTIPPAYLOAD_PTR htip, PACKET_PTR out) {
+	ENCODER measure = { NULL, 0 };
+	putBody(&measure, htip);
+	ENCODER encoder = { out, 0 };
+	putVarint(&encoder, measure.size);
+	putBody(&encoder, htip);
+	return packetOverflowed(out) ? 0 : encoder.size;
+}
+
+/** reads a varint, returns 0 if it runs past end */
+static int getVarint(const uint8_t ** data, const uint8_t * end,
+		uint32_t * value) {
+	uint32_t result = 0;
+	for (int shift = 0; shift < 35 && *data < end; shift += 7) {
+		uint8_t byte = *(*data)++;
+		result |= (uint32_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			*value = result;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/** points an INFOPIECE at a section: varint acount followed by the data */
+static int getInfopiece(const uint8_t * data, const uint8_t * end,
+		INFOPIECE_PTR info) {
+	uint32_t acount;
+	if (!getVarint(&data, end, &acount)) {
+		return 0;
+	}
+	info->acount = acount;
+	info->info = (uint8_t *) data;
+	info->size = end - data;
+	return 1;
+}
+
+size_t decodeHTIP(const uint8_t * data, size_t length, HTIPVIEW_PTR view) {
+	const uint8_t * p = data;
+	const uint8_t * end = data + length;
+	uint32_t bodyLength;
+	memset(view, 0, sizeof(HTIPVIEW));
+	if (!getVarint(&p, end, &bodyLength) || bodyLength > (size_t) (end - p)) {
+		return 0;
+	}
+	end = p + bodyLength;
+	if (end - p < 8 || p[0] != HTIPBINARY_VERSION) {
+		return 0;
+	}
+	view->src = &p[1];
+	p += 7;
+	if (!getVarint(&p, end, &view->recvTime) || !getVarint(&p, end, &view->ttl)
+			|| p >= end) {
+		return 0;
+	}
+	view->parseResult = *p++;
+	while (p < end) {
+		const uint8_t * section = p;
+		uint8_t tag = *p++;
+		uint32_t sectionLength;
+		if (!getVarint(&p, end, &sectionLength)
+				|| sectionLength > (size_t) (end - p)) {
+			return 0;
+		}
+		const uint8_t * sectionEnd = p + sectionLength;
+		INFOPIECE_PTR info = NULL;
+		switch (tag) {
+		case HTIPSECTION_CHASISID:
+			info = &view->chasisId;
+			break;
+		case HTIPSECTION_PORTID:
+			info = &view->portId;
+			break;
+		case HTIPSECTION_PORTDESCRIPTION:
+			info = &view->portDescription;
+			break;
+		case HTIPSECTION_DEVICECATEGORY:
+			info = &view->deviceCategory;
+			break;
+		case HTIPSECTION_MANUFACTURERCODE:
+			info = &view->manufacturerCode;
+			break;
+		case HTIPSECTION_MODELNAME:
+			info = &view->modelName;
+			break;
+		case HTIPSECTION_MODELNUMBER:
+			info = &view->modelNumber;
+			break;
+		case HTIPSECTION_MACS:
+			info = &view->macs;
+			break;
+		case HTIPSECTION_EXTMACS:
+			info = &view->extMacs;
+			break;
+		case HTIPSECTION_EXTCONNECTIVITY: {
+			//repeats once per port, the view spans from the first to the last
+			INFOPIECE port;
+			if (!getInfopiece(p, sectionEnd, &port) || port.acount > 0xFF) {
+				return 0;
+			}
+			if (view->connectivityCount++ == 0) {
+				view->connectivity = section;
+			}
+			view->connectivityLength = sectionEnd - view->connectivity;
+		}
+			break;
+		case HTIPSECTION_FORWARDINGTABLE: {
+			const uint8_t * ports = p;
+			if (!getVarint(&ports, sectionEnd, &view->ports)) {
+				return 0;
+			}
+			view->forwardingTable = ports;
+			view->forwardingTableLength = sectionEnd - ports;
+		}
+			break;
+		default:
+			//newer section, skip it
+			break;
+		}
+		if (info && !getInfopiece(p, sectionEnd, info)) {
+			return 0;
+		}
+		p = sectionEnd;
+	}
+	if (view->macs.info && (size_t) view->macs.acount * 6 > view->macs.size) {
+		return 0;
+	}
+	if (view->extMacs.info) {
+		//every length-prefixed address has to fit in the section
+		const uint8_t * entry = view->extMacs.info;
+		const uint8_t * extEnd = entry + view->extMacs.size;
+		for (uint32_t i = 0; i < view->extMacs.acount; i++) {
+			if (entry >= extEnd || entry[0] >= extEnd - entry) {
+				return 0;
+			}
+			entry += 1 + entry[0];
+		}
+		//same convention as HTIPPAYLOAD: info points past the length of the first address
+		if (view->extMacs.acount) {
+			view->extMacs.size = view->extMacs.info[0];
+			view->extMacs.info++;
+		} else {
+			view->extMacs.size = 0;
+		}
+	}
+	return end - data;
+}
+
+int htipViewNextConnectivity(HTIPVIEW_PTR view, size_t * offset,
+		INFOPIECE_PTR raw) {
+	const uint8_t * p = view->connectivity + *offset;
+	const uint8_t * end = view->connectivity + view->connectivityLength;
+	//decodeHTIP() checked the sections, other tags in between are skipped
+	while (p < end) {
+		uint8_t tag = *p++;
+		uint32_t sectionLength;
+		getVarint(&p, end, &sectionLength);
+		const uint8_t * sectionEnd = p + sectionLength;
+		if (tag == HTIPSECTION_EXTCONNECTIVITY) {
+			getInfopiece(p, sectionEnd, raw);
+			*offset = sectionEnd - view->connectivity;
+			return 1;
+		}
+		p = sectionEnd;
+	}
+	return 0;
+}
+
+int htipViewNextPort(HTIPVIEW_PTR view, size_t * offset, MACFTLV_PTR port) {
+	const uint8_t * p = view->forwardingTable + *offset;
+	const uint8_t * end = view->forwardingTable + view->forwardingTableLength;
+	uint32_t macs;
+	if (p >= end) {
+		return 0;
+	}
+	port->ifLength = *p >> 4;
+	port->portLength = *p & 0x0F;
+	p++;
+	if (!getVarint(&p, end, &port->ifType)
+			|| !getVarint(&p, end, &port->portNumber)
+			|| !getVarint(&p, end, &macs) || macs > 0xFF
+			|| macs * 6 > (size_t) (end - p)) {
+		return 0;
+	}
+	port->macLength = macs;
+	port->macs = (uint8_t *) p;
+	*offset = p + macs * 6 - view->forwardingTable;
+	return 1;
+}
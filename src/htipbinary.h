@@ -0,0 +1,103 @@
+/**
+ * \file
+ * \brief compact binary encoding of HTIPPAYLOAD for shipping parse results between processes
+ *
+ * Each record is a varint length followed by the body:
+ * - version (1 byte), source mac (6 bytes), recvTime (varint), ttl (varint), parseResult (1 byte)
+ * - sections, each one a tag byte, a varint length and the section data. Unknown tags are skipped.
+ *   INFOPIECE sections hold a varint acount followed by the raw bytes. The forwarding table section
+ *   holds a varint port count, and per port a byte with the interface type and port number lengths
+ *   (4 bits each), varint interface type, varint port number, varint mac count and the raw macs.
+ *   The extended connectivity section repeats once per port, as an INFOPIECE section whose acount is the
+ *   number of hosts and whose data is the raw information of the port starting at the port length.
+ *
+ * Decoding does not copy anything: the resulting HTIPVIEW points into the received buffer.
+ */
+#ifndef __HTIPBINARY_H
+#define __HTIPBINARY_H
+
+#include "structs.h"
+
+/** version byte of the current encoding */
+#define HTIPBINARY_VERSION 1
+
+/** section tags */
+enum {
+	HTIPSECTION_CHASISID = 1,
+	HTIPSECTION_PORTID = 2,
+	HTIPSECTION_PORTDESCRIPTION = 4,
+	HTIPSECTION_DEVICECATEGORY = 10,
+	HTIPSECTION_MANUFACTURERCODE = 11,
+	HTIPSECTION_MODELNAME = 12,
+	HTIPSECTION_MODELNUMBER = 13,
+	HTIPSECTION_MACS = 14,
+	HTIPSECTION_EXTMACS = 15,
+	HTIPSECTION_EXTCONNECTIVITY = 16,
+	HTIPSECTION_FORWARDINGTABLE = 20
+};
+
+/**
+ * A decoded record. All pointers point into the buffer that was decoded, which must outlive the view.
+ * The INFOPIECE fields follow the HTIPPAYLOAD conventions, absent fields have a NULL info.
+ */
+typedef struct {
+	const uint8_t * src; /*!< source mac address (6 bytes) */
+	uint32_t recvTime; /*!< relative time the frame was received, in SECONDS */
+	uint32_t ttl; /*!< LLDP Time To Live */
+	uint8_t parseResult; /*!< 1 if the frame parsed successfully */
+	INFOPIECE chasisId; /*!< LLDP chasis id, acount is the subtype */
+	INFOPIECE portId; /*!< LLDP port id, acount is the subtype */
+	INFOPIECE portDescription; /*!< LLDP port description */
+	INFOPIECE deviceCategory; /*!< HTIP device category */
+	INFOPIECE manufacturerCode; /*!< HTIP manufacturer code */
+	INFOPIECE modelName; /*!< HTIP model name */
+	INFOPIECE modelNumber; /*!< HTIP model number */
+	INFOPIECE macs; /*!< HTIP bridge mac addresses, acount is the number of addresses */
+	INFOPIECE extMacs; /*!< HTIP extended mac addresses, same layout as in HTIPPAYLOAD */
+	uint32_t connectivityCount; /*!< number of extended connectivity ports, read them with htipViewNextConnectivity() */
+	const uint8_t * connectivity; /*!< the extended connectivity sections, from the first to the last */
+	size_t connectivityLength; /*!< length of connectivity in bytes */
+	uint32_t ports; /*!< number of forwarding table ports, read them with htipViewNextPort() */
+	const uint8_t * forwardingTable; /*!< encoded forwarding table ports */
+	size_t forwardingTableLength; /*!< length of forwardingTable in bytes */
+} HTIPVIEW, *HTIPVIEW_PTR;
+
+/**
+ * Appends the binary record of a payload to a packet, which serves as the output buffer.
+ * Several records can be appended to the same packet.
+ * @param htip the payload to encode
+ * @param out the packet to append to
+ * @return the number of bytes appended, 0 if the packet ran out of space
+ */
+size_t encodeHTIP(HTIPPAYLOAD_PTR htip, PACKET_PTR out);
+
+/**
+ * Decodes one record without copying
+ * @param data the received buffer, positioned at the start of a record
+ * @param length the number of bytes available
+ * @param view the view to fill in
+ * @return the number of bytes the record took, 0 if the record is truncated or malformed
+ */
+size_t decodeHTIP(const uint8_t * data, size_t length, HTIPVIEW_PTR view);
+
+/**
+ * Reads the raw extended connectivity information of the next port of a view, decode it with
+ * decodeExtConnectivity()
+ * @param view a view filled in by decodeHTIP()
+ * @param offset position in the extended connectivity sections, start with 0
+ * @param raw filled in with the raw information of the port, acount is the number of hosts
+ * @return 1 if a port was read, 0 after the last one
+ */
+int htipViewNextConnectivity(HTIPVIEW_PTR view, size_t * offset,
+		INFOPIECE_PTR raw);
+
+/**
+ * Reads the next forwarding table port of a view
+ * @param view a view filled in by decodeHTIP()
+ * @param offset position in the forwarding table, start with 0
+ * @param port filled in with the port, macs points into the decoded buffer
+ * @return 1 if a port was read, 0 at the end of the table or if the table is malformed
+ */
+int htipViewNextPort(HTIPVIEW_PTR view, size_t * offset, MACFTLV_PTR port);
+
+#endif
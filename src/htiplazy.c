@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+#include "htiplazy.h"
+#include "packetparse.h"
+#include "packetbuild.h"
+
+/** type, subtype and id of the TLV holding each HTIPFIELD */
+static const TLVINDEX fieldKeys[HTIPFIELD_COUNT] = {
+		[HTIPFIELD_PORTDESCRIPTION] = { 0, 4, 0, 0 },
+		[HTIPFIELD_DEVICECATEGORY] = { 0, 127, 1, 1 },
+		[HTIPFIELD_MANUFACTURERCODE] = { 0, 127, 1, 2 },
+		[HTIPFIELD_MODELNAME] = { 0, 127, 1, 3 },
+		[HTIPFIELD_MODELNUMBER] = { 0, 127, 1, 4 },
+		[HTIPFIELD_MACS] = { 0, 127, 3, 0 },
+		[HTIPFIELD_EXTMACS] = { 0, 127, 5, 0 }, };
+
+/**
+ * fills entry with the type, subtype and id of a TLV whose value is at least 4 bytes long for type 127.
+ * returns 1 if the TLV is one that gets decoded lazily
+ */
+static int classifyTLV(const uint8_t * data, size_t size, TLVINDEX_PTR entry) {
+	entry->type = parseTLVType((uint8_t *) data);
+	entry->subtype = 0;
+	entry->id = 0;
+	if (entry->type == 4) {
+		return 1;
+	}
+	if (entry->type != 127 || memcmp(&data[2], TTC_OUI, 3)) {
+		return 0;
+	}
+	entry->subtype = data[5];
+	if (entry->subtype == 1 && size > 4) {
+		entry->id = data[6];
+	}
+	return 1;
+}
+
+/** position of a walk over the indexed TLVs, see nextTLV() */
+typedef struct {
+	size_t position; /*!< next entry of the index */
+	size_t offset; /*!< next TLV past the index */
+} LAZYWALK;
+
+/** gets the next lazily decoded TLV, from the index and then from the rest of the frame */
+static int nextTLV(HTIPLAZY_PTR lazy, LAZYWALK * walk, TLVINDEX_PTR entry) {
+	if (walk->position < lazy->count) {
+		*entry = lazy->index[walk->position++];
+		return 1;
+	}
+	//the TLVs that didn't fit, parseLLDPLazy() already checked their lengths
+	while (lazy->rest && walk->offset < lazy->end) {
+		const uint8_t * data = &lazy->frame.data[walk->offset];
+		size_t size = parseTLVLength((uint8_t *) data);
+		entry->offset = walk->offset;
+		walk->offset += 2 + size;
+		if (classifyTLV(data, size, entry)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/** sets up a TLV structure for an indexed TLV and decodes it */
+static PARSEERROR decodeIndexed(HTIPLAZY_PTR lazy, TLVINDEX_PTR entry,
+		TLVVALUE_PTR value) {
+	TLV tlv;
+	tlv.data = (uint8_t *) &lazy->frame.data[entry->offset];
+	tlv.type = entry->type;
+	tlv.size = parseTLVLength(tlv.data);
+	tlv.datastart = entry->offset + 2;
+	return decodeTLV(&tlv, value);
+}
+
+PARSEERROR parseLLDPLazy(HTIPLAZY_PTR lazy, const uint8_t * frame,
+		size_t length) {
+	MACFTLV_PTR macftlvs = lazy->macftlvs;
+	size_t macftlvsCapacity = lazy->macftlvsCapacity;
+	EXTCONNECTIVITY_PTR connectivity = lazy->connectivity;
+	size_t connectivityCapacity = lazy->connectivityCapacity;
+	EXTHOST_PTR hosts = lazy->hosts;
+	size_t hostsCapacity = lazy->hostsCapacity;
+	memset(lazy, 0, offsetof(HTIPLAZY, index));
+	lazy->macftlvs = macftlvs;
+	lazy->macftlvsCapacity = macftlvsCapacity;
+	lazy->connectivity = connectivity;
+	lazy->connectivityCapacity = connectivityCapacity;
+	lazy->hosts = hosts;
+	lazy->hostsCapacity = hostsCapacity;
+	lazy->frame.data = frame;
+	lazy->frame.length = length;
+	if (length < sizeof(ETHHEADER)) {
+		return lazy->parseError = PARSE_ERR_NO_DATA;
+	}
+	if (length > UINT16_MAX) {
+		return lazy->parseError = PARSE_ERR_TLV_LENGTH;
+	}
+	lazy->src = ((ETHHEADER_PTR) frame)->SRC;
+
+	TLVCURSOR cursor;
+	TLV tlv;
+	TLVVALUE value;
+	TLVINDEX entry;
+	PARSEERROR error = PARSE_ERR_NO_END;
+	int next;
+	tlvCursorInit(&cursor, frame + sizeof(ETHHEADER),
+			length - sizeof(ETHHEADER));
+	while ((next = tlvCursorNext(&cursor, &tlv)) > 0) {
+		entry.offset = sizeof(ETHHEADER) + tlv.datastart - 2;
+		if (tlv.type == 0) {
+			error = PARSE_OK;
+			break;
+		}
+		if (tlv.type == 127) {
+			//only the header now, the rest is checked when it is decoded
+			if (tlv.size < 4) {
+				error = PARSE_ERR_TLV_TOO_SHORT;
+				break;
+			}
+		} else {
+			error = decodeTLV(&tlv, &value);
+			if (error != PARSE_OK) {
+				break;
+			}
+			error = PARSE_ERR_NO_END;
+			if (tlv.type == 1) {
+				lazy->chasisId = value.piece;
+			} else if (tlv.type == 2) {
+				lazy->portId = value.piece;
+			} else if (tlv.type == 3) {
+				lazy->ttl = value.piece;
+			}
+		}
+		if (!classifyTLV(tlv.data, tlv.size, &entry)) {
+			continue;
+		}
+		if (entry.subtype == 2) {
+			lazy->ports++;
+		} else if (entry.subtype == 4) {
+			lazy->connectivityPorts++;
+		}
+		if (lazy->count < HTIPLAZY_MAXTLVS) {
+			lazy->index[lazy->count++] = entry;
+		} else if (lazy->rest == 0) {
+			lazy->rest = entry.offset;
+		}
+	}
+	if (next <= 0) {
+		//the frame ended without an end tlv, or the cursor ran out of the frame
+		error = next == 0 ? PARSE_ERR_NO_END : (PARSEERROR) -next;
+		entry.offset = sizeof(ETHHEADER) + cursor.next;
+	}
+	lazy->end = entry.offset;
+	return lazy->parseError = error;
+}
+
+INFOPIECE_PTR htipLazyField(HTIPLAZY_PTR lazy, HTIPFIELD field) {
+	uint16_t bit = 1 << field;
+	if (lazy->decoded & bit) {
+		return lazy->missing & bit ? NULL : &lazy->fields[field];
+	}
+	lazy->decoded |= bit;
+	lazy->missing |= bit;
+	const TLVINDEX * key = &fieldKeys[field];
+	LAZYWALK walk = { 0, lazy->rest };
+	TLVINDEX entry;
+	TLVINDEX found;
+	TLVVALUE value;
+	int present = 0;
+	//the last one wins, same as parseLLDP() for fields that appear once
+	while (nextTLV(lazy, &walk, &entry)) {
+		if (entry.type == key->type && entry.subtype == key->subtype
+				&& entry.id == key->id) {
+			found = entry;
+			present = 1;
+		}
+	}
+	if (!present || decodeIndexed(lazy, &found, &value) != PARSE_OK) {
+		return NULL;
+	}
+	if (found.subtype == 1) {
+		//acount is the device information id, the payload doesn't keep it
+		value.piece.acount = 0;
+	}
+	lazy->fields[field] = value.piece;
+	lazy->missing &= ~bit;
+	return &lazy->fields[field];
+}
+
+MACFTLV_PTR htipLazyForwardingTable(HTIPLAZY_PTR lazy, size_t * count) {
+	if (!lazy->portsDone) {
+		if (lazy->ports > lazy->macftlvsCapacity) {
+			MACFTLV_PTR macftlvs = realloc(lazy->macftlvs,
+					lazy->ports * sizeof(MACFTLV));
+			if (macftlvs == NULL) {
+				*count = 0;
+				return NULL;
+			}
+			lazy->macftlvs = macftlvs;
+			lazy->macftlvsCapacity = lazy->ports;
+		}
+		LAZYWALK walk = { 0, lazy->rest };
+		TLVINDEX entry;
+		TLVVALUE value;
+		while (lazy->portsDecoded < lazy->ports
+				&& nextTLV(lazy, &walk, &entry)) {
+			if (entry.type == 127 && entry.subtype == 2
+					&& decodeIndexed(lazy, &entry, &value) == PARSE_OK) {
+				lazy->macftlvs[lazy->portsDecoded++] = value.macftlv;
+			}
+		}
+		lazy->portsDone = 1;
+	}
+	*count = lazy->portsDecoded;
+	return lazy->portsDecoded ? lazy->macftlvs : NULL;
+}
+
+/** grows a block kept between frames to hold count entries of size bytes, -1 if it can't be allocated */
+static int reserveKept(void ** block, size_t * capacity, size_t count,
+		size_t size) {
+	if (count <= *capacity) {
+		return 0;
+	}
+	void * grown = realloc(*block, count * size);
+	if (grown == NULL) {
+		return -1;
+	}
+	*block = grown;
+	*capacity = count;
+	return 0;
+}
+
+EXTCONNECTIVITY_PTR htipLazyConnectivity(HTIPLAZY_PTR lazy, size_t * count) {
+	if (!lazy->connectivityDone) {
+		LAZYWALK walk = { 0, lazy->rest };
+		TLVINDEX entry;
+		TLVVALUE value;
+		size_t hosts = 0;
+		//the hosts of every port first, so that the block doesn't move under the decoded ports
+		while (nextTLV(lazy, &walk, &entry)) {
+			if (entry.type == 127 && entry.subtype == 4
+					&& decodeIndexed(lazy, &entry, &value) == PARSE_OK) {
+				hosts += value.piece.acount;
+			}
+		}
+		if (reserveKept((void **) &lazy->connectivity,
+				&lazy->connectivityCapacity, lazy->connectivityPorts,
+				sizeof(EXTCONNECTIVITY))
+				|| reserveKept((void **) &lazy->hosts, &lazy->hostsCapacity,
+						hosts, sizeof(EXTHOST))) {
+			*count = 0;
+			return NULL;
+		}
+		walk.position = 0;
+		walk.offset = lazy->rest;
+		hosts = 0;
+		while (lazy->connectivityDecoded < lazy->connectivityPorts
+				&& nextTLV(lazy, &walk, &entry)) {
+			if (entry.type != 127 || entry.subtype != 4
+					|| decodeIndexed(lazy, &entry, &value) != PARSE_OK) {
+				continue;
+			}
+			EXTCONNECTIVITY_PTR conn =
+					&lazy->connectivity[lazy->connectivityDecoded];
+			if (decodeExtConnectivity(&value.piece, conn, &lazy->hosts[hosts],
+					lazy->hostsCapacity - hosts) == 0) {
+				for (int i = 0; i < conn->hostCount; i++) {
+					conn->hosts[i].port = lazy->connectivityDecoded;
+				}
+				hosts += conn->hostCount;
+				lazy->connectivityDecoded++;
+			}
+		}
+		lazy->connectivityDone = 1;
+	}
+	*count = lazy->connectivityDecoded;
+	return lazy->connectivityDecoded ? lazy->connectivity : NULL;
+}
+
+void releaseHTIPLazy(HTIPLAZY_PTR lazy) {
+	free(lazy->macftlvs);
+	lazy->macftlvs = NULL;
+	lazy->macftlvsCapacity = 0;
+	free(lazy->connectivity);
+	lazy->connectivity = NULL;
+	lazy->connectivityCapacity = 0;
+	free(lazy->hosts);
+	lazy->hosts = NULL;
+	lazy->hostsCapacity = 0;
+}
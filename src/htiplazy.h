@@ -0,0 +1,122 @@
+/**
+ * \file
+ * \brief lazy parsing of LLDP/HTIP frames, fields are decoded on first access
+ *
+ * parseLLDPLazy() checks the TLV structure of a frame and decodes only the source mac address, chasis id,
+ * port id and TTL. Every other TLV is only recorded in a small index (type, HTIP subtype and offset), and
+ * the accessors decode it the first time it is asked for and remember the result. A query that only wants
+ * to know who is alive never touches the HTIP TLVs.
+ *
+ * The frame is borrowed, it must stay valid for as long as the HTIPLAZY is used.
+ */
+#ifndef __HTIP_LAZY_H
+#define __HTIP_LAZY_H
+
+#include "structs.h"
+
+/** number of TLVs kept in the index, TLVs past these are found by walking the rest of the frame */
+#ifndef HTIPLAZY_MAXTLVS
+#define HTIPLAZY_MAXTLVS 32
+#endif
+
+/**
+ * Location of one TLV of the frame
+ */
+typedef struct {
+	uint16_t offset; /*!< offset of the TLV header from the start of the frame */
+	uint8_t type; /*!< LLDP type */
+	uint8_t subtype; /*!< HTIP subtype for TTC TLVs, 0 for every other TLV */
+	uint8_t id; /*!< device information id for HTIP subtype 1, 0 otherwise */
+} TLVINDEX, *TLVINDEX_PTR;
+
+/**
+ * The fields that are decoded on demand, see htipLazyField(). The forwarding table and the extended
+ * connectivity repeat once per port and have accessors of their own.
+ */
+typedef enum {
+	HTIPFIELD_PORTDESCRIPTION = 0, /*!< LLDP port description (type 4) */
+	HTIPFIELD_DEVICECATEGORY, /*!< HTIP device category (1/1) */
+	HTIPFIELD_MANUFACTURERCODE, /*!< HTIP manufacturer code (1/2) */
+	HTIPFIELD_MODELNAME, /*!< HTIP model name (1/3) */
+	HTIPFIELD_MODELNUMBER, /*!< HTIP model number (1/4) */
+	HTIPFIELD_MACS, /*!< HTIP bridge mac addresses (3), acount is the number of addresses */
+	HTIPFIELD_EXTMACS, /*!< HTIP extended mac addresses (5), as HTIPPAYLOAD::extMacs */
+	HTIPFIELD_COUNT
+} HTIPFIELD;
+
+/**
+ * A lazily parsed frame
+ */
+typedef struct {
+	FRAMEVIEW frame; /*!< the borrowed frame */
+	uint32_t recvTime; /*!< receive time in SECONDS, for the caller to fill in */
+	PARSEERROR parseError; /*!< structural errors of the frame, PARSE_OK on success */
+	const uint8_t * src; /*!< source mac address, NULL if the frame is too short */
+	INFOPIECE chasisId; /*!< LLDP chasis id (type 1), acount is the subtype */
+	INFOPIECE portId; /*!< LLDP port id (type 2), acount is the subtype */
+	INFOPIECE ttl; /*!< LLDP Time To Live (type 3), in acount */
+	uint16_t count; /*!< number of TLVs in the index */
+	uint16_t rest; /*!< offset of the first TLV that did not fit in the index, 0 if all did */
+	uint16_t end; /*!< offset of the End Of LLDPDU TLV, or of the offending TLV if parseError is set */
+	uint16_t ports; /*!< number of mac forwarding table TLVs in the frame */
+	uint16_t connectivityPorts; /*!< number of extended connectivity TLVs in the frame */
+	uint16_t decoded; /*!< bit (1 << HTIPFIELD) is set for every field that was looked up already */
+	uint16_t missing; /*!< bit (1 << HTIPFIELD) is set for every field that is absent or failed to decode */
+	uint16_t portsDecoded; /*!< number of entries of macftlvs decoded, valid when portsDone is set */
+	uint8_t portsDone; /*!< the forwarding table was looked up already */
+	uint16_t connectivityDecoded; /*!< number of entries of connectivity decoded, valid when connectivityDone is set */
+	uint8_t connectivityDone; /*!< the extended connectivity was looked up already */
+	INFOPIECE fields[HTIPFIELD_COUNT]; /*!< decoded fields, valid when their decoded bit is set */
+	MACFTLV_PTR macftlvs; /*!< decoded forwarding table, kept between frames */
+	size_t macftlvsCapacity; /*!< number of entries macftlvs can hold */
+	EXTCONNECTIVITY_PTR connectivity; /*!< decoded extended connectivity, kept between frames */
+	size_t connectivityCapacity; /*!< number of entries connectivity can hold */
+	EXTHOST_PTR hosts; /*!< hosts of all entries of connectivity, kept between frames */
+	size_t hostsCapacity; /*!< number of entries hosts can hold */
+	TLVINDEX index[HTIPLAZY_MAXTLVS]; /*!< the TLVs of the frame, in frame order */
+} HTIPLAZY, *HTIPLAZY_PTR;
+
+/**
+ * Checks the TLV structure of a frame and indexes its TLVs. Only the source mac address, chasis id, port
+ * id and TTL are decoded. The structure must be zeroed before its first use, afterwards it can be reused
+ * for other frames as is.
+ * @param lazy the structure to fill
+ * @param frame the frame, starting at the ethernet header. Borrowed.
+ * @param length the length of the frame
+ * @return PARSE_OK, or why the frame is malformed (also stored in lazy->parseError). The contents of HTIP
+ * TLVs are not checked until they are accessed. Frames longer than 65535 bytes fail with
+ * PARSE_ERR_TLV_LENGTH.
+ */
+PARSEERROR parseLLDPLazy(HTIPLAZY_PTR lazy, const uint8_t * frame,
+		size_t length);
+/**
+ * Gets a field of a lazily parsed frame, decoding it on the first call
+ * @param lazy the parsed frame
+ * @param field the field to get
+ * @return the field, or NULL if the frame doesn't have it or its TLV is malformed
+ */
+INFOPIECE_PTR htipLazyField(HTIPLAZY_PTR lazy, HTIPFIELD field);
+/**
+ * Gets the mac forwarding table of a lazily parsed frame, decoding it on the first call
+ * @param lazy the parsed frame
+ * @param count set to the number of ports
+ * @return the ports in frame order, or NULL if there are none or the table could not be allocated. Ports
+ * whose TLV is malformed are left out.
+ */
+MACFTLV_PTR htipLazyForwardingTable(HTIPLAZY_PTR lazy, size_t * count);
+/**
+ * Gets the extended connectivity of a lazily parsed frame, one entry per port, decoding it on the first
+ * call
+ * @param lazy the parsed frame
+ * @param count set to the number of ports
+ * @return the ports in frame order, or NULL if there are none or they could not be allocated. Ports whose
+ * TLV is malformed are left out.
+ */
+EXTCONNECTIVITY_PTR htipLazyConnectivity(HTIPLAZY_PTR lazy, size_t * count);
+/**
+ * Frees the memory the structure keeps between frames. The structure can still be reused afterwards.
+ * @param lazy the structure to release
+ */
+void releaseHTIPLazy(HTIPLAZY_PTR lazy);
+
+#endif
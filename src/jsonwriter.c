@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <string.h>
+#include "jsonwriter.h"
+
+static const char HEXDIGITS[] = "0123456789abcdef";
+
+/** two decimal digits for every number below 100 */
+static const char DECIMALPAIRS[] = "00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+int jsonInitBuffer(JSONWRITER_PTR writer, size_t capacity) {
+	memset(writer, 0, sizeof(JSONWRITER));
+	writer->capacity = capacity ? capacity : 256;
+	writer->buffer = malloc(writer->capacity);
+	if (writer->buffer == NULL) {
+		writer->error = 1;
+		return -1;
+	}
+	return 0;
+}
+
+void jsonInitSink(JSONWRITER_PTR writer, char * buffer, size_t capacity,
+		JSONSINK sink, void * context) {
+	memset(writer, 0, sizeof(JSONWRITER));
+	writer->buffer = buffer;
+	writer->capacity = capacity;
+	writer->sink = sink;
+	writer->context = context;
+}
+
+int jsonFlush(JSONWRITER_PTR writer) {
+	if (writer->sink && writer->size && !writer->error) {
+		if (writer->sink(writer->context, writer->buffer, writer->size)
+				< writer->size) {
+			writer->error = 1;
+		}
+		writer->size = 0;
+	}
+	return writer->error ? -1 : 0;
+}
+
+/** makes room for length more bytes, returns a pointer to write them to or NULL */
+static char * reserve(JSONWRITER_PTR writer, size_t length) {
+	if (writer->error) {
+		return NULL;
+	}
+	if (writer->capacity - writer->size < length) {
+		if (writer->sink) {
+			jsonFlush(writer);
+			if (writer->error || writer->capacity < length) {
+				writer->error = 1;
+				return NULL;
+			}
+		} else {
+			size_t capacity = writer->capacity * 2;
+			while (capacity - writer->size < length) {
+				capacity *= 2;
+			}
+			char * buffer = realloc(writer->buffer, capacity);
+			if (buffer == NULL) {
+				writer->error = 1;
+				return NULL;
+			}
+			writer->buffer = buffer;
+			writer->capacity = capacity;
+		}
+	}
+	char * out = &writer->buffer[writer->size];
+	writer->size += length;
+	return out;
+}
+
+static void put(JSONWRITER_PTR writer, const char * data, size_t length) {
+	if (writer->sink && length > writer->capacity - writer->size) {
+		//does not fit, hand it to the sink directly
+		if (jsonFlush(writer) == 0
+				&& writer->sink(writer->context, data, length) < length) {
+			writer->error = 1;
+		}
+		return;
+	}
+	char * out = reserve(writer, length);
+	if (out) {
+		memcpy(out, data, length);
+	}
+}
+
+/** writes the separator needed before the next key or value */
+static void separate(JSONWRITER_PTR writer) {
+	if (writer->afterKey) {
+		writer->afterKey = 0;
+		return;
+	}
+	if (writer->depth == 0) {
+		return;
+	}
+	uint32_t bit = 1u << (writer->depth - 1);
+	if (writer->first & bit) {
+		writer->first &= ~bit;
+	} else {
+		put(writer, ",", 1);
+	}
+}
+
+static void beginContainer(JSONWRITER_PTR writer, char bracket) {
+	separate(writer);
+	if (writer->depth >= JSON_MAXDEPTH) {
+		writer->error = 1;
+		return;
+	}
+	put(writer, &bracket, 1);
+	writer->first |= 1u << writer->depth;
+	writer->depth++;
+}
+
+static void endContainer(JSONWRITER_PTR writer, char bracket) {
+	if (writer->depth == 0) {
+		writer->error = 1;
+		return;
+	}
+	writer->depth--;
+	writer->first &= ~(1u << writer->depth);
+	put(writer, &bracket, 1);
+}
+
+char * jsonFinish(JSONWRITER_PTR writer) {
+	char * out = reserve(writer, 1);
+	if (out == NULL || writer->sink || writer->depth) {
+		if (!writer->sink) {
+			free(writer->buffer);
+		}
+		writer->buffer = NULL;
+		return NULL;
+	}
+	*out = '\0';
+	return writer->buffer;
+}
+
+void jsonBeginObject(JSONWRITER_PTR writer) {
+	beginContainer(writer, '{');
+}
+
+void jsonEndObject(JSONWRITER_PTR writer) {
+	endContainer(writer, '}');
+}
+
+void jsonBeginArray(JSONWRITER_PTR writer) {
+	beginContainer(writer, '[');
+}
+
+void jsonEndArray(JSONWRITER_PTR writer) {
+	endContainer(writer, ']');
+}
+
+void jsonKey(JSONWRITER_PTR writer, const char * key) {
+	separate(writer);
+	put(writer, "\"", 1);
+	put(writer, key, strlen(key));
+	put(writer, "\":", 2);
+	writer->afterKey = 1;
+}
+
+void jsonString(JSONWRITER_PTR writer, const uint8_t * data, size_t length) {
+	if (length && data[length - 1] == 0) {
+		length--;
+	}
+	separate(writer);
+	put(writer, "\"", 1);
+	size_t start = 0;
+	for (size_t i = 0; i < length; i++) {
+		uint8_t c = data[i];
+		//JSON is UTF-8, only control characters, quotes and backslashes are escaped
+		if (c >= 0x20 && c != 0x7F && c != '"' && c != '\\') {
+			continue;
+		}
+		//copy the plain run, then the escape
+		put(writer, (const char *) &data[start], i - start);
+		start = i + 1;
+		char escape[6] = { '\\', (char) c, '0', '0', HEXDIGITS[c >> 4],
+				HEXDIGITS[c & 0x0F] };
+		if (c == '"' || c == '\\') {
+			put(writer, escape, 2);
+		} else {
+			escape[1] = 'u';
+			put(writer, escape, 6);
+		}
+	}
+	put(writer, (const char *) &data[start], length - start);
+	put(writer, "\"", 1);
+}
+
+/** formats value right-aligned at the end of digits, returns the number of characters */
+static size_t formatUInt(char * digits, uint32_t value) {
+	//uint32_t has at most 10 digits
+	char * end = digits + 10;
+	char * p = end;
+	while (value >= 100) {
+		uint32_t pair = value % 100;
+		value /= 100;
+		p -= 2;
+		memcpy(p, &DECIMALPAIRS[pair * 2], 2);
+	}
+	if (value >= 10) {
+		p -= 2;
+		memcpy(p, &DECIMALPAIRS[value * 2], 2);
+	} else {
+		*--p = '0' + value;
+	}
+	return end - p;
+}
+
+void jsonUInt(JSONWRITER_PTR writer, uint32_t value) {
+	char digits[10];
+	size_t length = formatUInt(digits, value);
+	separate(writer);
+	put(writer, digits + 10 - length, length);
+}
+
+void jsonUIntString(JSONWRITER_PTR writer, uint32_t value) {
+	char digits[12];
+	size_t length = formatUInt(digits + 1, value);
+	digits[10 - length] = '"';
+	digits[11] = '"';
+	separate(writer);
+	put(writer, digits + 10 - length, length + 2);
+}
+
+void jsonInt(JSONWRITER_PTR writer, int32_t value) {
+	if (value >= 0) {
+		jsonUInt(writer, value);
+		return;
+	}
+	char digits[11];
+	size_t length = formatUInt(digits + 1, 0u - (uint32_t) value);
+	digits[10 - length] = '-';
+	separate(writer);
+	put(writer, digits + 10 - length, length + 1);
+}
+
+/** bytes formatted at once by jsonMac() and jsonHex() */
+#define HEXCHUNK 32
+
+void jsonMac(JSONWRITER_PTR writer, const uint8_t * mac, size_t length) {
+	char text[HEXCHUNK * 3];
+	separate(writer);
+	put(writer, "\"", 1);
+	while (length) {
+		size_t chunk = length > HEXCHUNK ? HEXCHUNK : length;
+		char * out = text;
+		for (size_t i = 0; i < chunk; i++) {
+			*out++ = HEXDIGITS[mac[i] >> 4];
+			*out++ = HEXDIGITS[mac[i] & 0x0F];
+			*out++ = ':';
+		}
+		mac += chunk;
+		length -= chunk;
+		//no separator after the last byte
+		put(writer, text, out - text - (length == 0));
+	}
+	put(writer, "\"", 1);
+}
+
+void jsonHex(JSONWRITER_PTR writer, const uint8_t * data, size_t length) {
+	char text[HEXCHUNK * 2];
+	separate(writer);
+	put(writer, "\"", 1);
+	while (length) {
+		size_t chunk = length > HEXCHUNK ? HEXCHUNK : length;
+		for (size_t i = 0; i < chunk; i++) {
+			text[i * 2] = HEXDIGITS[data[i] >> 4];
+			text[i * 2 + 1] = HEXDIGITS[data[i] & 0x0F];
+		}
+		put(writer, text, chunk * 2);
+		data += chunk;
+		length -= chunk;
+	}
+	put(writer, "\"", 1);
+}
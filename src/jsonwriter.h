@@ -0,0 +1,111 @@
+/**
+ * \file
+ * \brief streaming JSON writer
+ *
+ * Writes JSON either into a buffer that grows as needed, or through a fixed buffer that is flushed
+ * to a sink callback whenever it fills up. Commas between values are handled by the writer, strings
+ * are escaped, and numbers and mac addresses are formatted with lookup tables instead of sprintf.
+ */
+#ifndef __JSONWRITER_H
+#define __JSONWRITER_H
+
+#include "structs.h"
+
+/** maximum nesting depth of objects and arrays */
+#define JSON_MAXDEPTH 32
+
+/**
+ * Receives a chunk of JSON output
+ * @return the number of bytes consumed, anything less than length is treated as an error
+ */
+typedef size_t (*JSONSINK)(void * context, const char * data, size_t length);
+
+/**
+ * The writer state. Set it up with jsonInitBuffer() or jsonInitSink().
+ */
+typedef struct {
+	char * buffer; /*!< output buffer */
+	size_t size; /*!< bytes used in the buffer */
+	size_t capacity; /*!< size of the buffer */
+	JSONSINK sink; /*!< if set, the buffer is flushed here when full instead of growing */
+	void * context; /*!< passed to the sink */
+	uint32_t first; /*!< one bit per nesting level, set while the container is still empty */
+	uint8_t depth; /*!< current nesting level */
+	uint8_t afterKey; /*!< a key was just written, the value follows without a comma */
+	uint8_t error; /*!< an allocation, sink or nesting error happened, the output is incomplete */
+} JSONWRITER, *JSONWRITER_PTR;
+
+/**
+ * Sets up a writer that collects the output in a heap buffer that grows as needed
+ * @param writer the writer to set up
+ * @param capacity the initial size of the buffer
+ * @return 0 on success, -1 if the allocation failed
+ */
+int jsonInitBuffer(JSONWRITER_PTR writer, size_t capacity);
+
+/**
+ * Sets up a writer that streams its output to a sink through a caller-provided buffer
+ * @param writer the writer to set up
+ * @param buffer the buffer used to batch writes to the sink
+ * @param capacity the size of the buffer
+ * @param sink the callback receiving the output
+ * @param context passed to the sink
+ */
+void jsonInitSink(JSONWRITER_PTR writer, char * buffer, size_t capacity,
+		JSONSINK sink, void * context);
+
+/**
+ * Hands everything written so far to the sink. Does nothing for buffer writers.
+ * @return 0 on success, -1 if the writer is in error
+ */
+int jsonFlush(JSONWRITER_PTR writer);
+
+/**
+ * Finishes a buffer writer
+ * @param writer a writer set up with jsonInitBuffer()
+ * @return the zero-terminated JSON text (free it afterwards), or NULL on error
+ */
+char * jsonFinish(JSONWRITER_PTR writer);
+
+void jsonBeginObject(JSONWRITER_PTR writer);
+void jsonEndObject(JSONWRITER_PTR writer);
+void jsonBeginArray(JSONWRITER_PTR writer);
+void jsonEndArray(JSONWRITER_PTR writer);
+
+/**
+ * Writes an object key, the next call writes its value
+ * @param writer the writer
+ * @param key zero-terminated key, written as is (no escaping)
+ */
+void jsonKey(JSONWRITER_PTR writer, const char * key);
+
+/**
+ * Writes an escaped string value. A trailing zero byte is dropped, control characters are written as
+ * \\u00XX escapes and every byte from 0x80 up is copied as is, so UTF-8 text stays the same text.
+ * @param writer the writer
+ * @param data the string
+ * @param length length of the string
+ */
+void jsonString(JSONWRITER_PTR writer, const uint8_t * data, size_t length);
+
+/** writes an unsigned number */
+void jsonUInt(JSONWRITER_PTR writer, uint32_t value);
+
+/** writes an unsigned number as a string value, e.g. "42" */
+void jsonUIntString(JSONWRITER_PTR writer, uint32_t value);
+
+/** writes a signed number */
+void jsonInt(JSONWRITER_PTR writer, int32_t value);
+
+/**
+ * Writes a mac address string value, bytes in hex separated by ':' (e.g. "01:02:03:04:05:06")
+ * @param writer the writer
+ * @param mac the address
+ * @param length the address length, usually 6
+ */
+void jsonMac(JSONWRITER_PTR writer, const uint8_t * mac, size_t length);
+
+/** writes binary data as a hex string value */
+void jsonHex(JSONWRITER_PTR writer, const uint8_t * data, size_t length);
+
+#endif
@@ -6,18 +6,54 @@
  * (LLDP/HTIP over GRE).
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <lwip/opt.h>
-#include <lwip/def.h>
-#include <lwip/tcpip.h>
-#include <lwip/netif.h>
 
-#include "htip_tasks.h"
 #include "packetbuild.h"
+#include "platform.h"
 #include "l2agent.h"
 
-#define ETHLLDP ntohs(0x88CC)
+/** most interfaces the agent sends on */
+#ifndef L2AGENT_MAXIFACES
+#define L2AGENT_MAXIFACES 32
+#endif
+
+/** frames sent one second apart when a link comes up, the first one included (LLDP txFastInit) */
+#ifndef L2AGENT_TXFAST
+#define L2AGENT_TXFAST 4
+#endif
+
+/** milliseconds between the fast frames (LLDP msgFastTx) */
+#ifndef L2AGENT_FASTINTERVAL
+#define L2AGENT_FASTINTERVAL 1000
+#endif
+
+/** milliseconds before generating the frame of an interface is tried again after it failed */
+#ifndef L2AGENT_RETRYINTERVAL
+#define L2AGENT_RETRYINTERVAL 1000
+#endif
+
+/** at most this percentage of sendInterval is taken off each deadline, so that agents don't synchronize */
+#ifndef L2AGENT_JITTER
+#define L2AGENT_JITTER 10
+#endif
+
+/**
+ * milliseconds between two interface checks when nothing calls l2agentNotifyLink(), 0 to rely on it.
+ * The POSIX port has no link callback to hook into, so it polls by default.
+ */
+#ifndef L2AGENT_LINKPOLL
+#ifdef HTIP_PLATFORM_POSIX
+#define L2AGENT_LINKPOLL 1000
+#else
+#define L2AGENT_LINKPOLL 0
+#endif
+#endif
+
+/** platformWake() events of the agent */
+#define L2AGENT_EVENT_CHANGE 0x01
+#define L2AGENT_EVENT_LINK 0x02
 
 #ifndef ENET_MAC
 #define ENET_MAC { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 }
@@ -41,27 +77,28 @@ uint8_t ttl = 3;
 uint8_t MAC_SRC[6] = ENET_MAC;
 
 /**
- * Example of a function that generates an HTIP frame. Mimic this function in order
- * to generate your own HTIP frames
- * @param ttl only the Time to live as a parameter, everything else is static
+ * Example of a function that generates an HTIP frame template. Mimic this function in order
+ * to generate your own HTIP frames. The fields that change between sends are recorded in the
+ * template so that they can be patched in place later.
+ * @param tmpl the template that will hold the frame
+ * @param iface the interface this frame is generated for
  * @return a frame pointer that contains the raw LLDP frame, including the ethernet header
  */
-
-PACKET_PTR generateHtipFrame(struct netif * iface) {
+PACKET_PTR generateHtipTemplate(HTIPTEMPLATE_PTR tmpl, PLATFORMIFACE_PTR iface) {
 	const uint8_t MAC_DST[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
-	const uint16_t ethlldp = ETHLLDP;
 
 	PACKET_PTR p = allocatePacket();
+	if (p == NULL) {
+		return NULL;
+	}
+	initTemplate(tmpl, p);
 //push ethernet header
-
-	pPokeMany(p, MAC_DST, sizeof(MAC_DST));
-	pPokeMany(p, iface->hwaddr, iface->hwaddr_len);
-	pPokeMany(p, (const uint8_t *) &ethlldp, 2);
+	templateEthernetHeader(tmpl, MAC_DST, iface->hwaddr);
 
 //LLDP fields
 	createChasisIDTLV(p, 4, MAC_SRC, sizeof(MAC_SRC));
-	createPortIDTLV(p, 1, (uint8_t *) iface->name, sizeof(iface->name));
-	createTTLTLV(p, ttl);
+	templatePortIDTLV(tmpl, 1, (uint8_t *) iface->name, iface->nameLength);
+	templateTTLTLV(tmpl, ttl);
 	createPortDescriptionTLV(p, (uint8_t *) portDescription,
 			strlen(portDescription));
 
@@ -73,12 +110,12 @@ PACKET_PTR generateHtipFrame(struct netif * iface) {
 	createModelNumberTLV(p, (uint8_t *) modelNumber, strlen(modelNumber));
 
 	//EXTENDED STUFF
-	createChannelUseStateTLV(p, channelUseState);
-	createSignalStrengthTLV(p, signalStrength);
-	createCommunicationErrorTLV(p, communicationError);
+	templateChannelUseStateTLV(tmpl, channelUseState);
+	templateSignalStrengthTLV(tmpl, signalStrength);
+	templateCommunicationErrorTLV(tmpl, communicationError);
 
-	createStatusInformationTLV(p, strlen(status), (uint8_t *) status);
-	createLLDPDUSendInterval(p, sendInterval);
+	templateStatusInformationTLV(tmpl, strlen(status), (uint8_t *) status);
+	templateLLDPDUSendInterval(tmpl, sendInterval);
 
 	/*
 	 MACFTLV macf;
@@ -103,9 +140,44 @@ PACKET_PTR generateHtipFrame(struct netif * iface) {
 	 */
 //end field
 	createLastTLV(p);
+	if (packetOverflowed(p)) {
+		freePacket(p);
+		return NULL;
+	}
 	return p;
 }
 
+/**
+ * Patches the dynamic fields of a template generated by generateHtipTemplate() for
+ * the given interface.
+ * @param tmpl the template to update
+ * @param iface the interface the frame will be sent on
+ * @return 0 on success, non-zero if the template has to be regenerated
+ */
+int updateHtipTemplate(HTIPTEMPLATE_PTR tmpl, PLATFORMIFACE_PTR iface) {
+	patchSourceMac(tmpl, iface->hwaddr);
+	patchTTL(tmpl, ttl);
+	patchChannelUseState(tmpl, channelUseState);
+	patchSignalStrength(tmpl, signalStrength);
+	patchCommunicationError(tmpl, communicationError);
+	patchLLDPDUSendInterval(tmpl, sendInterval);
+	if (patchPortID(tmpl, (uint8_t *) iface->name, iface->nameLength)) {
+		return -1;
+	}
+	return patchStatusInformation(tmpl, strlen(status), (uint8_t *) status);
+}
+
+/**
+ * Example of a function that generates an HTIP frame. Mimic this function in order
+ * to generate your own HTIP frames
+ * @param iface the interface this frame is generated for
+ * @return a frame pointer that contains the raw LLDP frame, including the ethernet header
+ */
+PACKET_PTR generateHtipFrame(PLATFORMIFACE_PTR iface) {
+	HTIPTEMPLATE tmpl;
+	return generateHtipTemplate(&tmpl, iface);
+}
+
 /**
  * This is an example for generating a GRE/HTIP frame.
  * @param ttl only the Time to live as a parameter, everything else is static
@@ -115,14 +187,17 @@ PACKET_PTR generateExtendedFrameTest(uint16_t ttl) {
 
 	const uint8_t MAC_DST[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
 
-	const uint16_t ethtype = ETHLLDP;
+	const uint8_t ethtype[] = { 0x88, 0xCC };
 
 	PACKET_PTR p = allocatePacket();
+	if (p == NULL) {
+		return NULL;
+	}
 //push ethernet header
 
 	pPokeMany(p, MAC_DST, sizeof(MAC_DST));	//not really used here but has to be here either way
 	pPokeMany(p, MAC_SRC, sizeof(MAC_SRC));
-	pPokeMany(p, (const uint8_t *) &ethtype, 2);
+	pPokeMany(p, ethtype, sizeof(ethtype));
 //LLDP fields
 	uint8_t chasisId[] = "fake chasis id";
 	createChasisIDTLV(p, 7, chasisId, sizeof(chasisId));
@@ -148,7 +223,8 @@ PACKET_PTR generateExtendedFrameTest(uint16_t ttl) {
 	createStatusInformationTLV(p, strlen(status), (const uint8_t *) status);
 	createLLDPDUSendInterval(p, 128);
 
-	TLV_PTR extCon = startExtendConnnectivityInformation(p);
+	TLV extConTlv;
+	TLV_PTR extCon = startExtendConnnectivityInformation(&extConTlv, p);
 	uint8_t portLength = 1;
 	uint32_t portNum = 24;
 	uint8_t macLength = 12;
@@ -171,7 +247,8 @@ PACKET_PTR generateExtendedFrameTest(uint16_t ttl) {
 	addPerPortChannelInfo(extCon, 3, channelInfo);
 	endExtendedTlv(extCon);
 
-	TLV_PTR emac = startExtendMacTlv(p, 2);
+	TLV emacTlv;
+	TLV_PTR emac = startExtendMacTlv(&emacTlv, p, 2);
 	addExtendedMac(emac, 4, (uint8_t *) "4444");
 	addExtendedMac(emac, 10, (uint8_t *) "AAAAAAAAAA");
 	endExtendedTlv(emac);
@@ -203,63 +280,187 @@ PACKET_PTR generateExtendedFrameTest(uint16_t ttl) {
 	 *
 	 */
 	createLastTLV(p);
+	if (packetOverflowed(p)) {
+		freePacket(p);
+		return NULL;
+	}
 	return p;
 }
 
-/**
- * This is what I think should be an ideal just-send-the-packet
- * type of function.
- */
-err_t iface_send(struct netif *netif, PACKET_PTR packet) {
-	LOCK_TCPIP_CORE();
-	struct pbuf * lowpacket = pbuf_alloc(PBUF_RAW_TX,
-			packet->control.dataoffset, PBUF_REF);
-	lowpacket->payload = packet->data;
-	err_t result = netif->linkoutput(netif, lowpacket);
-	pbuf_free(lowpacket);
-	UNLOCK_TCPIP_CORE();
-	return result;
+/** per interface transmit state of the agent */
+typedef struct {
+	void * handle; /*!< platform handle of the interface, with index identifies it */
+	int index; /*!< platform index of the interface */
+	uint8_t used; /*!< non-zero if this slot tracks an interface that is up */
+	uint8_t seen; /*!< non-zero if the interface was up at the current check */
+	uint8_t fast; /*!< fast transmissions left */
+	uint32_t deadline; /*!< platformNow() time of the next transmission */
+	HTIPTEMPLATE tmpl; /*!< the frame of this interface, patched before every send */
+	PACKET_PTR packet; /*!< the frame, NULL until it is first generated */
+} AGENTIFACE;
+
+static AGENTIFACE agentIfaces[L2AGENT_MAXIFACES];
+static uint32_t jitterState;
+
+/** returns non-zero if time a comes after time b, platformNow() wraps around */
+static int after(uint32_t a, uint32_t b) {
+	return (int32_t) (a - b) > 0;
+}
+
+/** xorshift, good enough for spreading transmissions */
+static uint32_t jitter(uint32_t interval) {
+	uint32_t range = interval * L2AGENT_JITTER / 100;
+	jitterState ^= jitterState << 13;
+	jitterState ^= jitterState >> 17;
+	jitterState ^= jitterState << 5;
+	return range ? jitterState % range : 0;
+}
+
+/** finds the state of an interface, or a free slot for it */
+static AGENTIFACE * findAgentIface(PLATFORMIFACE_PTR iface) {
+	AGENTIFACE * slot = NULL;
+	for (int i = 0; i < L2AGENT_MAXIFACES; i++) {
+		AGENTIFACE * state = &agentIfaces[i];
+		if (!state->used) {
+			if (slot == NULL) {
+				slot = state;
+			}
+		} else if (state->handle == iface->handle
+				&& state->index == iface->index) {
+			return state;
+		}
+	}
+	if (slot) {
+		//link came up: send now and then one second apart, L2AGENT_TXFAST frames in all
+		memset(slot, 0, sizeof(AGENTIFACE));
+		slot->used = 1;
+		slot->handle = iface->handle;
+		slot->index = iface->index;
+		slot->fast = L2AGENT_TXFAST;
+		slot->deadline = platformNow();
+	}
+	return slot;
+}
+
+void l2agentNotifyChange(void) {
+	platformWake(L2AGENT_EVENT_CHANGE);
+}
+
+void l2agentNotifyLink(void) {
+	platformWake(L2AGENT_EVENT_LINK);
 }
 
 /**
  * main HTIP Agent task here
  *
- * Registers the LLDP handler function and also sends generated HTIP frames
+ * Sends generated HTIP frames on every interface that is up, through the platform layer. Every interface has
+ * its own deadline: a frame every sendInterval seconds (minus some jitter), L2AGENT_TXFAST frames one second
+ * apart when a link comes up (the first one right away), and a frame right away on l2agentNotifyChange().
+ * Between deadlines the task sleeps.
  */
 void l2agent() {
 	printf("SEND task started\n");
-	//setup MAC_SRC outgoing source mac address
-	//just grab the default interface and copy six bytes
-	memcpy(MAC_SRC, netif_default->hwaddr, 6);
-
-	err_t sendstatus;
-	PACKET_PTR packet;
-
-#define NETFLAGS (NETIF_FLAG_UP | NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP | NETIF_FLAG_ETHARP)
-	while (1) {
+	if (platformInit()) {
+		printf("HTIP platform init failed\n");
+		return;
+	}
 
-		for (struct netif * iface = netif_default; iface != NULL;
-				iface = iface->next) {
-			//check that we have an ethernet device that uses arp, its up, linkup and does broadcasting
-			if (NETFLAGS == (iface->flags & NETFLAGS)) {
+	int sendstatus;
+	uint32_t events = 0;
+	PLATFORMIFACE ifaces[L2AGENT_MAXIFACES];
+	TXREQUEST requests[L2AGENT_MAXIFACES];
 
-				/* generate the htip frame */
-				packet = generateHtipFrame(iface);
+	//setup MAC_SRC outgoing source mac address
+	//just grab the first (default) interface and copy six bytes
+	size_t count = platformInterfaces(ifaces, L2AGENT_MAXIFACES);
+	if (count > 0) {
+		memcpy(MAC_SRC, ifaces[0].hwaddr, 6);
+	}
+	jitterState = platformNow() ^ ((uint32_t) MAC_SRC[2] << 24)
+			^ ((uint32_t) MAC_SRC[3] << 16) ^ ((uint32_t) MAC_SRC[4] << 8)
+			^ MAC_SRC[5];
+	if (jitterState == 0) {
+		jitterState = 1;
+	}
 
-				/* actually sending the frame here */
-				for (int j = 0; j < 3; j++) {
-					//burst send 3 packets, for testing
-					sendstatus = iface_send(iface, packet);
-					printf("Sent HTIP! status: %d\r\n", sendstatus);
+	while (1) {
+		size_t queued = 0;
+		uint32_t now = platformNow();
+		uint32_t interval = sendInterval * 1000;
+		uint32_t wait = interval;
+		count = platformInterfaces(ifaces, L2AGENT_MAXIFACES);
+		for (size_t i = 0; i < count; i++) {
+			if (!ifaces[i].up) {
+				continue;
+			}
+			AGENTIFACE * state = findAgentIface(&ifaces[i]);
+			if (state == NULL) {
+				continue;
+			}
+			if (events & L2AGENT_EVENT_CHANGE) {
+				state->deadline = now;
+			}
+			state->seen = 1;
+			if (after(state->deadline, now)) {
+				if (state->deadline - now < wait) {
+					wait = state->deadline - now;
+				}
+				continue;
+			}
+			/* patch the htip frame, regenerate it only if a length changed */
+			if (state->packet != NULL
+					&& updateHtipTemplate(&state->tmpl, &ifaces[i])) {
+				freePacket(state->packet);
+				state->packet = NULL;
+			}
+			if (state->packet == NULL) {
+				state->packet = generateHtipTemplate(&state->tmpl, &ifaces[i]);
+				if (state->packet == NULL) {
+					//out of memory, try again soon rather than a whole interval later
+					state->deadline = now + L2AGENT_RETRYINTERVAL;
+					if (L2AGENT_RETRYINTERVAL < wait) {
+						wait = L2AGENT_RETRYINTERVAL;
+					}
+					continue;
 				}
-
-				freePacket(packet);
+			}
+			requests[queued].iface = &ifaces[i];
+			requests[queued].packet = state->packet;
+			requests[queued].repeat = 1;
+			queued++;
+			//this frame counts against the fast ones, the last of them waits a whole interval
+			if (state->fast && --state->fast) {
+				state->deadline = now + L2AGENT_FASTINTERVAL;
+			} else {
+				state->deadline = now + interval - jitter(interval);
+			}
+			if (state->deadline - now < wait) {
+				wait = state->deadline - now;
 			}
 		}
+		//interfaces that were not seen up this time went down, forget them
+		for (int i = 0; i < L2AGENT_MAXIFACES; i++) {
+			AGENTIFACE * state = &agentIfaces[i];
+			if (state->used && !state->seen) {
+				freePacket(state->packet);
+				state->packet = NULL;
+				state->used = 0;
+			}
+			state->seen = 0;
+		}
 
-		//update after half of the time has elapsed
-		vTaskDelay(sendInterval * 1000 / portTICK_PERIOD_MS);
+		/* actually sending the frames here, all interfaces in one batch */
+		if (queued) {
+			sendstatus = platformSend(requests, queued);
+			printf("Sent HTIP! status: %d\r\n", sendstatus);
+		}
+
+#if L2AGENT_LINKPOLL
+		if (wait > L2AGENT_LINKPOLL) {
+			wait = L2AGENT_LINKPOLL;
+		}
+#endif
+		events = platformWait(wait);
 	}
 
 }
-
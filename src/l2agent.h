@@ -24,4 +24,19 @@ extern uint8_t communicationError;
 extern uint8_t sendInterval;
 extern uint8_t ttl;
 
+/**
+ * Tells the agent that one of the fields above changed, so that it is advertised on every interface right
+ * away instead of at the next interval. Call it after changing the fields, from any task.
+ */
+void l2agentNotifyChange(void);
+/**
+ * Tells the agent that a link went up or down (e.g. from a netif_set_link_callback() callback), so that a
+ * new link starts its fast transmissions right away. Call it from any task.
+ */
+void l2agentNotifyLink(void);
+/**
+ * main HTIP Agent task, never returns unless the platform cannot be initialized
+ */
+void l2agent();
+
 #endif /* L2AGENT_H_ */
@@ -0,0 +1,213 @@
+#include "lldpinput.h"
+
+#ifdef HTIP_PLATFORM_LWIP
+
+#include <string.h>
+#include <lwip/tcpip.h>
+#include "packetbuild.h"
+#include "packetparse.h"
+
+static HTIPCACHEENTRY cache[HTIPCACHE_ENTRIES];
+/** TLVs that straddle two pbufs are copied here. Only the TCPIP thread uses it. */
+static uint8_t scratch[2 + 0x1FF];
+/** the entry being filled while a frame is parsed, committed to the cache on success */
+static HTIPCACHEENTRY incoming;
+/** set by htipInputDefer(), the frames go there instead of the cache */
+static FRAMERING_PTR deferRing;
+static PACKETPOOL_PTR deferPool;
+
+/** non-zero if the entry is in use and not expired */
+static int isLive(HTIPCACHEENTRY_PTR entry, uint32_t now) {
+	return entry->used && (int32_t) (entry->expires - now) > 0;
+}
+
+/** copies a field into the incoming entry, truncating it if the entry is full */
+static void keepField(HTIPCACHEFIELD field, const uint8_t * data,
+		size_t length) {
+	size_t room = HTIPCACHE_DATASIZE - incoming.size;
+	if (length > room) {
+		length = room;
+	}
+	incoming.fields[field].offset = incoming.size;
+	incoming.fields[field].length = length;
+	memcpy(&incoming.data[incoming.size], data, length);
+	incoming.size += length;
+}
+
+static void keepValue(TLV_PTR tlv, TLVVALUE_PTR value) {
+	switch (tlv->type) {
+	case 1:
+		incoming.chasisIdType = value->piece.acount;
+		keepField(HTIPCACHE_CHASISID, value->piece.info, value->piece.size);
+		break;
+	case 2:
+		incoming.portIdType = value->piece.acount;
+		keepField(HTIPCACHE_PORTID, value->piece.info, value->piece.size);
+		break;
+	case 3:
+		incoming.ttl = value->piece.acount;
+		break;
+	case 4:
+		keepField(HTIPCACHE_PORTDESCRIPTION, value->piece.info,
+				value->piece.size);
+		break;
+	case 127:
+		if (value->subtype == 1 && value->piece.acount >= 1
+				&& value->piece.acount <= 4) {
+			//device category, manufacturer code, model name, model number
+			keepField(
+					HTIPCACHE_DEVICECATEGORY + (value->piece.acount - 1),
+					value->piece.info, value->piece.size);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/** walks the TLVs of the frame in place, returns PARSE_OK once the end TLV is reached */
+static PARSEERROR parsePbuf(struct pbuf * p) {
+	uint16_t offset = sizeof(ETHHEADER);
+	uint8_t header[2];
+	TLV tlv;
+	TLVVALUE value;
+	while (pbuf_copy_partial(p, header, 2, offset) == 2) {
+		tlv.type = parseTLVType(header);
+		tlv.size = parseTLVLength(header);
+		tlv.datastart = offset + 2;
+		if (tlv.datastart + tlv.size > p->tot_len) {
+			return PARSE_ERR_TLV_LENGTH;
+		}
+		tlv.data = pbuf_get_contiguous(p, scratch, sizeof(scratch),
+				tlv.size + 2, offset);
+		if (tlv.data == NULL) {
+			return PARSE_ERR_TLV_LENGTH;
+		}
+		PARSEERROR error = decodeTLV(&tlv, &value);
+		if (error != PARSE_OK) {
+			return error;
+		}
+		if (tlv.type == 0) {
+			return PARSE_OK;
+		}
+		keepValue(&tlv, &value);
+		offset += tlv.size + 2;
+	}
+	return offset < p->tot_len ? PARSE_ERR_TLV_HEADER : PARSE_ERR_NO_END;
+}
+
+/** stores the incoming entry, replacing the same neighbor or the one closest to expiry */
+static void commitIncoming(uint32_t now) {
+	HTIPCACHEENTRY_PTR slot = NULL;
+	for (int i = 0; i < HTIPCACHE_ENTRIES; i++) {
+		HTIPCACHEENTRY_PTR entry = &cache[i];
+		if (entry->used && !memcmp(entry->mac, incoming.mac, 6)) {
+			slot = entry;
+			break;
+		}
+		if (!isLive(entry, now)) {
+			//free or expired, better than evicting a live neighbor
+			if (slot == NULL || isLive(slot, now)) {
+				slot = entry;
+			}
+		} else if (slot == NULL
+				|| (isLive(slot, now)
+						&& (int32_t) (entry->expires - slot->expires) < 0)) {
+			slot = entry;
+		}
+	}
+	if (incoming.ttl == 0) {
+		//ttl 0 is a shutdown frame, forget the neighbor
+		if (slot && slot->used && !memcmp(slot->mac, incoming.mac, 6)) {
+			slot->used = 0;
+		}
+		return;
+	}
+	incoming.used = 1;
+	incoming.expires = now + (uint32_t) incoming.ttl * 1000;
+	memcpy(slot, &incoming, sizeof(HTIPCACHEENTRY));
+}
+
+/** copies the frame into a pooled packet and pushes it to the defer ring */
+static void deferFrame(struct pbuf * p, struct netif * netif) {
+	if (p->len == p->tot_len) {
+		frameRingPushCopy(deferRing, deferPool, p->payload, p->len,
+				platformNow() / 1000, netif->num);
+		return;
+	}
+	//chained pbuf, copy it piece by piece
+	PACKET_PTR packet = poolAcquire(deferPool);
+	if (packet == NULL || p->tot_len > packet->control.allocated) {
+		if (packet) {
+			poolRelease(deferPool, packet);
+		}
+		deferRing->dropped++;
+		return;
+	}
+	packet->control.dataoffset = pbuf_copy_partial(p, packet->data,
+			p->tot_len, 0);
+	FRAMEDESC frame = { packet->data, packet->control.dataoffset,
+			platformNow() / 1000, netif->num, packet };
+	if (frameRingPush(deferRing, &frame)) {
+		poolRelease(deferPool, packet);
+	}
+}
+
+void htipInputDefer(FRAMERING_PTR ring, PACKETPOOL_PTR pool) {
+	deferPool = pool;
+	deferRing = ring;
+}
+
+err_t htipInput(struct pbuf * p, struct netif * netif) {
+	const uint8_t * frame = p->payload;
+	if (p->len < sizeof(ETHHEADER) || frame[12] != 0x88 || frame[13] != 0xCC) {
+#ifdef HTIPINPUT_NEXT
+		return HTIPINPUT_NEXT(p, netif);
+#else
+		return ERR_VAL;
+#endif
+	}
+	if (deferRing) {
+		deferFrame(p, netif);
+		pbuf_free(p);
+		return ERR_OK;
+	}
+	memset(&incoming, 0, sizeof(HTIPCACHEENTRY));
+	memcpy(incoming.mac, &frame[6], 6);
+	incoming.netif = netif;
+	if (parsePbuf(p) == PARSE_OK) {
+		commitIncoming(platformNow());
+	}
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+int htipCacheCopy(const uint8_t * mac, HTIPCACHEENTRY_PTR out) {
+	int found = 0;
+	LOCK_TCPIP_CORE();
+	uint32_t now = platformNow();
+	for (int i = 0; i < HTIPCACHE_ENTRIES; i++) {
+		if (isLive(&cache[i], now) && !memcmp(cache[i].mac, mac, 6)) {
+			memcpy(out, &cache[i], sizeof(HTIPCACHEENTRY));
+			found = 1;
+			break;
+		}
+	}
+	UNLOCK_TCPIP_CORE();
+	return found;
+}
+
+size_t htipCacheSnapshot(HTIPCACHEENTRY_PTR out, size_t max) {
+	size_t count = 0;
+	LOCK_TCPIP_CORE();
+	uint32_t now = platformNow();
+	for (int i = 0; i < HTIPCACHE_ENTRIES && count < max; i++) {
+		if (isLive(&cache[i], now)) {
+			memcpy(&out[count++], &cache[i], sizeof(HTIPCACHEENTRY));
+		}
+	}
+	UNLOCK_TCPIP_CORE();
+	return count;
+}
+
+#endif
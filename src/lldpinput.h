@@ -0,0 +1,112 @@
+/**
+ * \file
+ * \brief lwIP receive side: parses LLDP/HTIP frames straight from pbufs into a small neighbor cache
+ *
+ * Hook htipInput() into lwIP from lwipopts.h:
+ *
+ *     #define LWIP_HOOK_UNKNOWN_ETH_PROTOCOL(pbuf, netif) htipInput(pbuf, netif)
+ *
+ * Every TLV is decoded where it lies in the (possibly chained) pbuf; only a TLV that straddles two
+ * pbufs is copied, into a static scratch buffer. The fields the cache keeps are copied into the cache
+ * entry before the pbuf is released, so no frame is ever linearized or allocated on the heap. The hook
+ * runs in the TCPIP thread; other tasks read the cache with htipCacheCopy().
+ *
+ * To parse in another task instead, call htipInputDefer(): the hook then only copies LLDP frames into a
+ * FRAMERING, and the cache is not used.
+ *
+ * Frames of other ethertypes are passed to HTIPINPUT_NEXT(pbuf, netif) when it is defined, so that
+ * the hook can be shared with the application.
+ */
+#ifndef __LLDPINPUT_H
+#define __LLDPINPUT_H
+
+#include "platform.h"
+
+#ifdef HTIP_PLATFORM_LWIP
+
+#include <lwip/netif.h>
+#include "framering.h"
+
+/** number of neighbors the cache keeps, the one closest to expiry makes room for a new one */
+#ifndef HTIPCACHE_ENTRIES
+#define HTIPCACHE_ENTRIES 8
+#endif
+
+/** bytes of field data kept per neighbor, longer fields are truncated */
+#ifndef HTIPCACHE_DATASIZE
+#define HTIPCACHE_DATASIZE 192
+#endif
+
+/** fields kept by the cache */
+typedef enum {
+	HTIPCACHE_CHASISID,
+	HTIPCACHE_PORTID,
+	HTIPCACHE_PORTDESCRIPTION,
+	HTIPCACHE_DEVICECATEGORY,
+	HTIPCACHE_MANUFACTURERCODE,
+	HTIPCACHE_MODELNAME,
+	HTIPCACHE_MODELNUMBER,
+	HTIPCACHE_FIELDS
+} HTIPCACHEFIELD;
+
+/**
+ * Location of a field inside HTIPCACHEENTRY::data, length is 0 if the field was absent
+ */
+typedef struct {
+	uint16_t offset; /*!< offset of the field in data */
+	uint16_t length; /*!< length of the field */
+} HTIPCACHESPAN;
+
+/**
+ * A cached neighbor
+ */
+typedef struct {
+	uint8_t used; /*!< non-zero if the entry holds a neighbor */
+	uint8_t mac[6]; /*!< source mac address of the neighbor */
+	uint8_t chasisIdType; /*!< LLDP chasis id subtype */
+	uint8_t portIdType; /*!< LLDP port id subtype */
+	uint16_t ttl; /*!< LLDP Time To Live, in seconds */
+	uint32_t expires; /*!< platformNow() time the entry expires */
+	struct netif * netif; /*!< the interface the neighbor was heard on */
+	HTIPCACHESPAN fields[HTIPCACHE_FIELDS]; /*!< the kept fields, indexed by HTIPCACHEFIELD */
+	uint16_t size; /*!< bytes used in data */
+	uint8_t data[HTIPCACHE_DATASIZE]; /*!< copies of the kept fields */
+} HTIPCACHEENTRY, *HTIPCACHEENTRY_PTR;
+
+/**
+ * The LWIP_HOOK_UNKNOWN_ETH_PROTOCOL hook. Consumes LLDP frames, malformed ones included.
+ * @param p the received frame, payload at the ethernet header
+ * @param netif the interface the frame was received on
+ * @return ERR_OK if the frame was consumed (and freed), otherwise lwIP drops it
+ */
+err_t htipInput(struct pbuf * p, struct netif * netif);
+
+/**
+ * Makes htipInput() defer parsing. Every LLDP frame is copied into a packet of pool and pushed to ring,
+ * with the interface number as ifindex and platformNow() / 1000 as timestamp. A task consumes the ring
+ * with frameRingIngest() and frameRingReleasePacket(). Call it before the hook receives frames, or
+ * holding the TCPIP core lock.
+ * @param ring the ring, the hook is its only producer. NULL parses into the cache again
+ * @param pool the pool the frames are copied into
+ */
+void htipInputDefer(FRAMERING_PTR ring, PACKETPOOL_PTR pool);
+
+/**
+ * Copies a neighbor out of the cache, holding the TCPIP core lock. Expired neighbors are not returned.
+ * @param mac the source mac address of the neighbor
+ * @param out where the neighbor is copied
+ * @return 1 if the neighbor was found, 0 otherwise
+ */
+int htipCacheCopy(const uint8_t * mac, HTIPCACHEENTRY_PTR out);
+
+/**
+ * Copies every live neighbor out of the cache, holding the TCPIP core lock
+ * @param out where the neighbors are copied
+ * @param max the size of the out array
+ * @return the number of neighbors copied
+ */
+size_t htipCacheSnapshot(HTIPCACHEENTRY_PTR out, size_t max);
+
+#endif
+
+#endif
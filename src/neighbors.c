@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <string.h>
+#include "neighbors.h"
+#include "packetparse.h"
+
+/** keep the load factor under 3/4 */
+#define NEEDSGROW(table) (((table)->count + 1) * 4 > (table)->capacity * 3)
+
+uint64_t macToKey(const uint8_t * mac) {
+	uint64_t key = 1; //the marker bit keeps the all-zero mac from looking empty
+	for (int i = 0; i < 6; i++) {
+		key = (key << 8) | mac[i];
+	}
+	return key;
+}
+
+uint64_t fingerprintFrame(const uint8_t * frame, size_t length) {
+	const uint64_t prime = 0x100000001B3ULL;
+	uint64_t hash = 0xCBF29CE484222325ULL ^ length;
+	size_t i = sizeof(ETHHEADER);
+	//eight bytes at a time, then the tail
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		memcpy(&word, &frame[i], 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; i < length; i++) {
+		hash = (hash ^ frame[i]) * prime;
+	}
+	hash ^= hash >> 32;
+	hash *= 0xD6E8FEB86659FD93ULL;
+	return hash ^ (hash >> 32);
+}
+
+static size_t slotOf(NEIGHBORTABLE_PTR table, uint64_t key) {
+	//fibonacci hashing, the top bits are the best mixed
+	return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (table->capacity - 1);
+}
+
+static NEIGHBOR_PTR findSlot(NEIGHBORTABLE_PTR table, uint64_t key) {
+	size_t mask = table->capacity - 1;
+	for (size_t i = slotOf(table, key);; i = (i + 1) & mask) {
+		NEIGHBOR_PTR entry = &table->entries[i];
+		if (entry->key == key || entry->key == 0) {
+			return entry;
+		}
+	}
+}
+
+static int growTable(NEIGHBORTABLE_PTR table) {
+	NEIGHBOR_PTR old = table->entries;
+	size_t oldCapacity = table->capacity;
+	NEIGHBOR_PTR entries = calloc(oldCapacity * 2, sizeof(NEIGHBOR));
+	if (entries == NULL) {
+		return -1;
+	}
+	table->entries = entries;
+	table->capacity = oldCapacity * 2;
+	for (size_t i = 0; i < oldCapacity; i++) {
+		if (old[i].key) {
+			*findSlot(table, old[i].key) = old[i];
+		}
+	}
+	free(old);
+	return 0;
+}
+
+/** empties a slot and shifts back the entries of its probe chain */
+static void removeSlot(NEIGHBORTABLE_PTR table, NEIGHBOR_PTR entry) {
+	size_t mask = table->capacity - 1;
+	size_t hole = entry - table->entries;
+	for (size_t i = (hole + 1) & mask; table->entries[i].key; i = (i + 1) & mask) {
+		size_t home = slotOf(table, table->entries[i].key);
+		//move the entry if its home slot is not between the hole and its position
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			table->entries[hole] = table->entries[i];
+			hole = i;
+		}
+	}
+	memset(&table->entries[hole], 0, sizeof(NEIGHBOR));
+	table->count--;
+}
+
+/** frees a payload that leaves the table, unless it can be kept as the spare */
+static void retireHTIP(NEIGHBORTABLE_PTR table, HTIPPAYLOAD_PTR htip) {
+	if (table->spare == NULL) {
+		table->spare = htip;
+	} else {
+		freeHTIP(htip);
+	}
+}
+
+NEIGHBORTABLE_PTR createNeighborTable(size_t capacity) {
+	NEIGHBORTABLE_PTR table = malloc(sizeof(NEIGHBORTABLE));
+	if (table == NULL) {
+		return NULL;
+	}
+	table->capacity = 16;
+	while (table->capacity * 3 < capacity * 4) {
+		table->capacity *= 2;
+	}
+	table->count = 0;
+	table->expired = 0;
+	table->spare = NULL;
+	//the first neighborExpire() catches the wheel up with whatever clock is used
+	timerWheelInit(&table->wheel, 0);
+	table->entries = calloc(table->capacity, sizeof(NEIGHBOR));
+	if (table->entries == NULL) {
+		free(table);
+		return NULL;
+	}
+	return table;
+}
+
+void destroyNeighborTable(NEIGHBORTABLE_PTR table) {
+	if (table == NULL) {
+		return;
+	}
+	for (size_t i = 0; i < table->capacity; i++) {
+		if (table->entries[i].key) {
+			freeHTIP(table->entries[i].htip);
+			free(table->entries[i].timer);
+		}
+	}
+	if (table->spare) {
+		freeHTIP(table->spare);
+	}
+	free(table->entries);
+	free(table);
+}
+
+HTIPPAYLOAD_PTR neighborUpdate(NEIGHBORTABLE_PTR table, HTIPPAYLOAD_PTR htip) {
+	if (htip->parseResult.acount != 1 || htip->src.info == NULL) {
+		retireHTIP(table, htip);
+		return NULL;
+	}
+	uint64_t key = macToKey(htip->src.info);
+	if (htip->ttl.acount == 0) {
+		//LLDP shutdown frame, the neighbor is leaving
+		neighborRemove(table, htip->src.info);
+		retireHTIP(table, htip);
+		return NULL;
+	}
+	NEIGHBOR_PTR entry = findSlot(table, key);
+	if (entry->key == 0) {
+		TIMERNODE_PTR timer = calloc(1, sizeof(TIMERNODE));
+		if (timer == NULL || (NEEDSGROW(table) && growTable(table))) {
+			free(timer);
+			retireHTIP(table, htip);
+			return NULL;
+		}
+		timer->key = key;
+		entry = findSlot(table, key);
+		entry->key = key;
+		entry->timer = timer;
+		table->count++;
+	} else {
+		retireHTIP(table, entry->htip);
+	}
+	entry->htip = htip;
+	entry->fingerprint = 0;
+	if (htip->packet.data && htip->packet.control.dataoffset >= sizeof(ETHHEADER)) {
+		entry->fingerprint = fingerprintFrame(htip->packet.data,
+				htip->packet.control.dataoffset);
+	}
+	entry->expires = htip->recvTime + htip->ttl.acount;
+	timerWheelSchedule(&table->wheel, entry->timer, entry->expires);
+	return htip;
+}
+
+HTIPPAYLOAD_PTR neighborIngest(NEIGHBORTABLE_PTR table, const uint8_t * frame,
+		size_t length, uint32_t now) {
+	if (length < sizeof(ETHHEADER)) {
+		return NULL;
+	}
+	ETHHEADER_PTR header = (ETHHEADER_PTR) frame;
+	NEIGHBOR_PTR entry = findSlot(table, macToKey(header->SRC));
+	uint64_t fingerprint = fingerprintFrame(frame, length);
+	if (entry->key && entry->fingerprint == fingerprint
+			&& entry->htip->packet.control.dataoffset == length) {
+		//same advertisement as last time, just refresh it
+		entry->htip->recvTime = now;
+		entry->expires = now + entry->htip->ttl.acount;
+		timerWheelSchedule(&table->wheel, entry->timer, entry->expires);
+		return entry->htip;
+	}
+	HTIPPAYLOAD_PTR htip = table->spare;
+	table->spare = NULL;
+	if (htip) {
+		resetHTIP(htip);
+	} else {
+		htip = calloc(1, sizeof(HTIPPAYLOAD));
+		if (htip == NULL) {
+			return NULL;
+		}
+	}
+	setHTIPdata(htip, length, (uint8_t *) frame);
+	if (htip->packet.data == NULL) {
+		retireHTIP(table, htip);
+		return NULL;
+	}
+	parseLLDP(htip, NULL, 0);
+	htip->recvTime = now;
+	return neighborUpdate(table, htip);
+}
+
+HTIPPAYLOAD_PTR neighborFind(NEIGHBORTABLE_PTR table, const uint8_t * mac) {
+	NEIGHBOR_PTR entry = findSlot(table, macToKey(mac));
+	return entry->key ? entry->htip : NULL;
+}
+
+int neighborRemove(NEIGHBORTABLE_PTR table, const uint8_t * mac) {
+	NEIGHBOR_PTR entry = findSlot(table, macToKey(mac));
+	if (entry->key == 0) {
+		return 0;
+	}
+	retireHTIP(table, entry->htip);
+	timerWheelCancel(&table->wheel, entry->timer);
+	free(entry->timer);
+	removeSlot(table, entry);
+	return 1;
+}
+
+/** timer wheel callback, removes the neighbors of the expired timers */
+static void expireNeighbors(void * context, TIMERNODE_PTR * expired,
+		size_t count) {
+	NEIGHBORTABLE_PTR table = context;
+	for (size_t i = 0; i < count; i++) {
+		NEIGHBOR_PTR entry = findSlot(table, expired[i]->key);
+		if (entry->key && entry->timer == expired[i]) {
+			retireHTIP(table, entry->htip);
+			free(entry->timer);
+			removeSlot(table, entry);
+			table->expired++;
+		}
+	}
+}
+
+size_t neighborExpire(NEIGHBORTABLE_PTR table, uint32_t now) {
+	table->expired = 0;
+	timerWheelAdvance(&table->wheel, now, expireNeighbors, table);
+	return table->expired;
+}
@@ -0,0 +1,118 @@
+/**
+ * \file
+ * \brief neighbor database of parsed HTIP frames, keyed by source mac address
+ *
+ * An open-addressing hash table that keeps the latest HTIPPAYLOAD of every neighbor.
+ * A new frame from a known source replaces the stored one, and entries expire once their
+ * LLDP Time To Live has passed. Expiry is driven by a timer wheel, so it only costs time for
+ * the entries that actually expire.
+ */
+#ifndef __NEIGHBORS_H
+#define __NEIGHBORS_H
+
+#include "structs.h"
+#include "timerwheel.h"
+
+/**
+ * A single neighbor entry
+ */
+typedef struct {
+	uint64_t key; /*!< source mac address packed by macToKey(), 0 marks an empty slot */
+	uint32_t expires; /*!< time this entry expires (recvTime + ttl), in SECONDS */
+	HTIPPAYLOAD_PTR htip; /*!< the latest parsed frame of this neighbor, owned by the table */
+	TIMERNODE_PTR timer; /*!< expiry timer of this neighbor, its key is the key of the entry */
+	uint64_t fingerprint; /*!< hash of the LLDP payload of the stored frame, see neighborIngest() */
+} NEIGHBOR, *NEIGHBOR_PTR;
+
+/**
+ * The neighbor table. Use createNeighborTable() to create one.
+ */
+typedef struct {
+	NEIGHBOR_PTR entries; /*!< the slots of the table */
+	size_t capacity; /*!< number of slots, always a power of two */
+	size_t count; /*!< number of neighbors in the table */
+	size_t expired; /*!< number of neighbors removed by the last neighborExpire() */
+	TIMERWHEEL wheel; /*!< expiry timers of all neighbors */
+	HTIPPAYLOAD_PTR spare; /*!< a payload that left the table, reused by the next neighborIngest() */
+} NEIGHBORTABLE, *NEIGHBORTABLE_PTR;
+
+/**
+ * Packs a 6-byte mac address into a key. The key is never 0.
+ * @param mac the mac address
+ * @return the key used by the neighbor table
+ */
+uint64_t macToKey(const uint8_t * mac);
+
+/**
+ * Hashes the LLDP payload of a frame (everything after the ethernet header) with a fast 64-bit
+ * non-cryptographic hash
+ * @param frame the frame, starting with the ethernet header
+ * @param length the length of the frame, at least the size of an ethernet header
+ * @return the fingerprint of the frame
+ */
+uint64_t fingerprintFrame(const uint8_t * frame, size_t length);
+
+/**
+ * Creates an empty neighbor table
+ * @param capacity the expected number of neighbors, the table grows when needed
+ * @return the table, or NULL if the allocation failed
+ */
+NEIGHBORTABLE_PTR createNeighborTable(size_t capacity);
+
+/**
+ * Frees the table along with every HTIPPAYLOAD stored in it
+ * @param table the table to free
+ */
+void destroyNeighborTable(NEIGHBORTABLE_PTR table);
+
+/**
+ * Stores a parsed frame in the table, replacing the previous frame of the same source.
+ * The table takes ownership of htip in every case: frames that did not parse, have no source
+ * or carry a TTL of 0 (which removes the neighbor) are freed right away.
+ * Set htip->recvTime before calling this, the entry expires at recvTime + ttl.
+ * @param table the neighbor table
+ * @param htip a frame parsed with parseLLDP() from data set with setHTIPdata()
+ * @return the stored payload, or NULL if the frame was not stored
+ */
+HTIPPAYLOAD_PTR neighborUpdate(NEIGHBORTABLE_PTR table, HTIPPAYLOAD_PTR htip);
+
+/**
+ * Ingests a raw frame. If the frame has the same length and payload fingerprint (a fast 64-bit
+ * non-cryptographic hash) as the frame stored for its source, which is the case for periodic
+ * re-advertisements, only the receive time and the expiry are refreshed and nothing is copied or
+ * parsed. Otherwise the frame is copied, parsed and stored with neighborUpdate(). The payload that a
+ * frame replaces is reset and kept for the next frame, so changing neighbors don't allocate either.
+ * @param table the neighbor table
+ * @param frame the frame, starting with the ethernet header
+ * @param length the length of the frame
+ * @param now the current time, in SECONDS
+ * @return the stored payload of the source, or NULL if the frame was not stored
+ */
+HTIPPAYLOAD_PTR neighborIngest(NEIGHBORTABLE_PTR table, const uint8_t * frame,
+		size_t length, uint32_t now);
+
+/**
+ * Looks up a neighbor
+ * @param table the neighbor table
+ * @param mac the source mac address of the neighbor
+ * @return the latest payload of the neighbor, or NULL if it is not known
+ */
+HTIPPAYLOAD_PTR neighborFind(NEIGHBORTABLE_PTR table, const uint8_t * mac);
+
+/**
+ * Removes a neighbor and frees its payload
+ * @param table the neighbor table
+ * @param mac the source mac address of the neighbor
+ * @return 1 if the neighbor was removed, 0 if it was not known
+ */
+int neighborRemove(NEIGHBORTABLE_PTR table, const uint8_t * mac);
+
+/**
+ * Removes every neighbor whose TTL has passed
+ * @param table the neighbor table
+ * @param now the current time, in SECONDS, on the same clock as recvTime
+ * @return the number of neighbors removed
+ */
+size_t neighborExpire(NEIGHBORTABLE_PTR table, uint32_t now);
+
+#endif
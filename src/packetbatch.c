@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include "packetbatch.h"
+#include "packetparse.h"
+
+/** default arena size, enough for a batch of typical HTIP frames */
+#define BATCH_DEFAULT_ARENA 16384
+
+HTIPBATCH_PTR createHTIPBatch(size_t capacity, size_t arenaCapacity) {
+	HTIPBATCH_PTR batch = calloc(1, sizeof(HTIPBATCH));
+	if (batch == NULL) {
+		return NULL;
+	}
+	if (arenaCapacity == 0) {
+		arenaCapacity = BATCH_DEFAULT_ARENA;
+	}
+	batch->capacity = capacity;
+	batch->src = malloc(capacity * 6);
+	batch->ttl = malloc(capacity * sizeof(uint16_t));
+	batch->parseError = malloc(capacity);
+	batch->chasisIdType = malloc(capacity);
+	batch->chasisId = malloc(capacity * sizeof(BATCHFIELD));
+	batch->portIdType = malloc(capacity);
+	batch->portId = malloc(capacity * sizeof(BATCHFIELD));
+	batch->portDescription = malloc(capacity * sizeof(BATCHFIELD));
+	batch->deviceCategory = malloc(capacity * sizeof(BATCHFIELD));
+	batch->manufacturerCode = malloc(capacity * sizeof(BATCHFIELD));
+	batch->modelName = malloc(capacity * sizeof(BATCHFIELD));
+	batch->modelNumber = malloc(capacity * sizeof(BATCHFIELD));
+	batch->macs = malloc(capacity * sizeof(BATCHFIELD));
+	batch->ports = malloc(capacity * sizeof(uint16_t));
+	batch->arena = malloc(arenaCapacity);
+	batch->arenaCapacity = arenaCapacity;
+	if (!batch->src || !batch->ttl || !batch->parseError
+			|| !batch->chasisIdType || !batch->chasisId || !batch->portIdType
+			|| !batch->portId || !batch->portDescription
+			|| !batch->deviceCategory || !batch->manufacturerCode
+			|| !batch->modelName || !batch->modelNumber || !batch->macs
+			|| !batch->ports || !batch->arena) {
+		freeHTIPBatch(batch);
+		return NULL;
+	}
+	return batch;
+}
+
+void freeHTIPBatch(HTIPBATCH_PTR batch) {
+	if (batch == NULL) {
+		return;
+	}
+	free(batch->src);
+	free(batch->ttl);
+	free(batch->parseError);
+	free(batch->chasisIdType);
+	free(batch->chasisId);
+	free(batch->portIdType);
+	free(batch->portId);
+	free(batch->portDescription);
+	free(batch->deviceCategory);
+	free(batch->manufacturerCode);
+	free(batch->modelName);
+	free(batch->modelNumber);
+	free(batch->macs);
+	free(batch->ports);
+	free(batch->arena);
+	free(batch);
+}
+
+void resetHTIPBatch(HTIPBATCH_PTR batch) {
+	batch->count = 0;
+	batch->arenaSize = 0;
+}
+
+const uint8_t * batchFieldData(HTIPBATCH_PTR batch, BATCHFIELD field) {
+	return batch->arena + field.offset;
+}
+
+/** makes sure the arena has room for length more bytes */
+static int reserveArena(HTIPBATCH_PTR batch, size_t length) {
+	size_t needed = batch->arenaSize + length;
+	if (needed <= batch->arenaCapacity) {
+		return 0;
+	}
+	//offsets are 32 bits wide
+	if (needed > UINT32_MAX) {
+		return -1;
+	}
+	size_t capacity = batch->arenaCapacity * 2;
+	while (capacity < needed) {
+		capacity *= 2;
+	}
+	uint8_t * arena = realloc(batch->arena, capacity);
+	if (arena == NULL) {
+		return -1;
+	}
+	batch->arena = arena;
+	batch->arenaCapacity = capacity;
+	return 0;
+}
+
+/** copies a piece to the arena, the arena must already have room for it */
+static BATCHFIELD putField(HTIPBATCH_PTR batch, const uint8_t * data,
+		size_t length) {
+	BATCHFIELD field = { batch->arenaSize, length };
+	memcpy(batch->arena + batch->arenaSize, data, length);
+	batch->arenaSize += length;
+	return field;
+}
+
+/** parses one frame into entry i of the batch */
+static PARSEERROR parseBatchEntry(HTIPBATCH_PTR batch, size_t i,
+		const FRAMEVIEW * frame) {
+	TLVCURSOR cursor;
+	TLV tlv;
+	TLVVALUE value;
+	int next;
+	PARSEERROR error;
+	if (frame->length < sizeof(ETHHEADER)) {
+		return PARSE_ERR_NO_DATA;
+	}
+	memcpy(&batch->src[i * 6], ((ETHHEADER_PTR) frame->data)->SRC, 6);
+	tlvCursorInit(&cursor, frame->data + 14, frame->length - 14);
+	while ((next = tlvCursorNext(&cursor, &tlv)) > 0) {
+		error = decodeTLV(&tlv, &value);
+		if (error != PARSE_OK) {
+			return error;
+		}
+		switch (tlv.type) {
+		case 0:
+			return PARSE_OK;
+		case 1:
+			batch->chasisIdType[i] = value.piece.acount;
+			batch->chasisId[i] = putField(batch, value.piece.info,
+					value.piece.size);
+			break;
+		case 2:
+			batch->portIdType[i] = value.piece.acount;
+			batch->portId[i] = putField(batch, value.piece.info,
+					value.piece.size);
+			break;
+		case 3:
+			batch->ttl[i] = value.piece.acount;
+			break;
+		case 4:
+			batch->portDescription[i] = putField(batch, value.piece.info,
+					value.piece.size);
+			break;
+		case 127:
+			switch (value.subtype) {
+			case 1:
+				switch (value.piece.acount) {
+				case 1:
+					batch->deviceCategory[i] = putField(batch,
+							value.piece.info, value.piece.size);
+					break;
+				case 2:
+					batch->manufacturerCode[i] = putField(batch,
+							value.piece.info, value.piece.size);
+					break;
+				case 3:
+					batch->modelName[i] = putField(batch, value.piece.info,
+							value.piece.size);
+					break;
+				case 4:
+					batch->modelNumber[i] = putField(batch, value.piece.info,
+							value.piece.size);
+					break;
+				}
+				break;
+			case 2:
+				batch->ports[i]++;
+				break;
+			case 3:
+				batch->macs[i] = putField(batch, value.piece.info,
+						(size_t) value.piece.acount * 6);
+				break;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return next == 0 ? PARSE_ERR_NO_END : (PARSEERROR) -next;
+}
+
+size_t parseLLDPBatch(HTIPBATCH_PTR batch, const FRAMEVIEW * frames,
+		size_t count) {
+	size_t added = 0;
+	const BATCHFIELD empty = { 0, 0 };
+	while (added < count && batch->count < batch->capacity) {
+		const FRAMEVIEW * frame = &frames[added];
+		size_t i = batch->count;
+		//the fields of a frame never take more room than the frame itself
+		if (reserveArena(batch, frame->length)) {
+			break;
+		}
+		memset(&batch->src[i * 6], 0, 6);
+		batch->ttl[i] = 0;
+		batch->chasisIdType[i] = 0;
+		batch->chasisId[i] = empty;
+		batch->portIdType[i] = 0;
+		batch->portId[i] = empty;
+		batch->portDescription[i] = empty;
+		batch->deviceCategory[i] = empty;
+		batch->manufacturerCode[i] = empty;
+		batch->modelName[i] = empty;
+		batch->modelNumber[i] = empty;
+		batch->macs[i] = empty;
+		batch->ports[i] = 0;
+		batch->parseError[i] = parseBatchEntry(batch, i, frame);
+		batch->count++;
+		added++;
+	}
+	return added;
+}
@@ -0,0 +1,81 @@
+/**
+ * \file
+ * \brief parsing of many frames at once into structure-of-arrays results
+ *
+ * Instead of one HTIPPAYLOAD per frame, a batch keeps one array per field, indexed by frame. Variable
+ * length fields are copied into a single arena owned by the batch and referred to by offset, so the
+ * results stay valid after the frame buffers are reused.
+ */
+#ifndef __PACKET_BATCH_H
+#define __PACKET_BATCH_H
+
+#include "structs.h"
+
+/**
+ * Location of a variable length field inside the batch arena. length is 0 if the field was absent.
+ */
+typedef struct {
+	uint32_t offset; /*!< offset of the field data in the arena */
+	uint32_t length; /*!< length of the field data in bytes */
+} BATCHFIELD;
+
+/**
+ * Parse results of a batch of frames, one array entry per frame
+ */
+typedef struct {
+	size_t capacity; /*!< number of frames the arrays can hold */
+	size_t count; /*!< number of frames parsed so far */
+	uint8_t * src; /*!< source mac addresses, 6 bytes per frame */
+	uint16_t * ttl; /*!< LLDP Time To Live */
+	uint8_t * parseError; /*!< PARSEERROR of each frame, PARSE_OK on success */
+	uint8_t * chasisIdType; /*!< LLDP chasis id subtype */
+	BATCHFIELD * chasisId; /*!< LLDP chasis id */
+	uint8_t * portIdType; /*!< LLDP port id subtype */
+	BATCHFIELD * portId; /*!< LLDP port id */
+	BATCHFIELD * portDescription; /*!< LLDP port description */
+	BATCHFIELD * deviceCategory; /*!< HTIP device category */
+	BATCHFIELD * manufacturerCode; /*!< HTIP manufacturer code */
+	BATCHFIELD * modelName; /*!< HTIP model name */
+	BATCHFIELD * modelNumber; /*!< HTIP model number */
+	BATCHFIELD * macs; /*!< HTIP bridge mac addresses, 6 bytes each */
+	uint16_t * ports; /*!< number of HTIP forwarding table TLVs */
+	uint8_t * arena; /*!< variable length data of every frame */
+	size_t arenaSize; /*!< bytes used in the arena */
+	size_t arenaCapacity; /*!< bytes allocated for the arena, grows as needed */
+} HTIPBATCH, *HTIPBATCH_PTR;
+
+/**
+ * Allocates a batch
+ * @param capacity the maximum number of frames per batch
+ * @param arenaCapacity initial size of the arena, 0 picks a default
+ * @return the new batch or NULL if an allocation failed
+ */
+HTIPBATCH_PTR createHTIPBatch(size_t capacity, size_t arenaCapacity);
+/**
+ * Frees a batch and its arena
+ * @param batch the batch to free
+ */
+void freeHTIPBatch(HTIPBATCH_PTR batch);
+/**
+ * Empties a batch so that it can be filled again, keeping its memory
+ * @param batch the batch to reset
+ */
+void resetHTIPBatch(HTIPBATCH_PTR batch);
+/**
+ * Parses frames into the batch, after the frames it already holds
+ * @param batch the batch to fill
+ * @param frames the frames to parse, each starting at the ethernet header
+ * @param count the number of frames
+ * @return the number of frames added, less than count if the batch is full or the arena could not grow
+ */
+size_t parseLLDPBatch(HTIPBATCH_PTR batch, const FRAMEVIEW * frames,
+		size_t count);
+/**
+ * Gets the data of a variable length field
+ * @param batch the batch the field belongs to
+ * @param field the field
+ * @return a pointer into the batch arena, valid until the next parseLLDPBatch() call
+ */
+const uint8_t * batchFieldData(HTIPBATCH_PTR batch, BATCHFIELD field);
+
+#endif
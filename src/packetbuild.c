@@ -1,48 +1,112 @@
 #include <stdlib.h>
 #include <string.h>
-#include "lwip/opt.h"
-#include "lwip/def.h"
+#include "platform.h"
 #include "packetbuild.h"
 
 /////////////////////////////////////////
 // Frame creation related functions here
 /////////////////////////////////////////
 
-PACKET_PTR allocatePacket() {
-	size_t initsize = 1500;
-	PACKET_PTR packet = (PACKET_PTR) malloc(initsize);
+PACKET_PTR allocatePacketSized(size_t size) {
+	if (size > PACKET_MAX_SIZE) {
+		return NULL;
+	}
+	PACKET_PTR packet = (PACKET_PTR) malloc(sizeof(PACKET) + size);
 	if (packet != NULL) {
 		//we have a successful allocation
-		//setup fields
-		memset(packet, 0, initsize);
-		//what is this?!
-		packet->control.allocated = initsize - (sizeof(PACKET));
+		//setup fields, the data itself is overwritten while building so it is not cleared
+		memset(packet, 0, sizeof(PACKET));
+		packet->control.allocated = size;
 		packet->data = (uint8_t *) packet + (sizeof(PACKET));
 	}
 	return packet;
 }
 
+PACKET_PTR allocatePacket() {
+	//the PACKET header lives in the same block as the data
+	return allocatePacketSized(PACKET_DEFAULT_SIZE - sizeof(PACKET));
+}
+
+int reservePacket(PACKET_PTR packet, size_t length) {
+	PACKETCONTROL * control = &packet->control;
+	if (control->flags & PACKET_FLAG_OVERFLOW) {
+		return -1;
+	}
+	if (length <= control->allocated - control->dataoffset) {
+		return 0;
+	}
+#if PACKET_GROWABLE
+	size_t needed = control->dataoffset + length;
+	if (needed <= PACKET_MAX_SIZE) {
+		size_t capacity = control->allocated * 2;
+		if (capacity < needed) {
+			capacity = needed;
+		}
+		if (capacity > PACKET_MAX_SIZE) {
+			capacity = PACKET_MAX_SIZE;
+		}
+		uint8_t * data;
+		if (control->flags & PACKET_FLAG_EXTERNAL) {
+			data = realloc(packet->data, capacity);
+		} else {
+			//the original buffer shares the block with the header, move out of it
+			data = malloc(capacity);
+			if (data) {
+				memcpy(data, packet->data, control->dataoffset);
+			}
+		}
+		if (data) {
+			packet->data = data;
+			control->allocated = capacity;
+			control->flags |= PACKET_FLAG_EXTERNAL;
+			return 0;
+		}
+	}
+#endif
+	control->flags |= PACKET_FLAG_OVERFLOW;
+	return -1;
+}
+
+int packetOverflowed(PACKET_PTR packet) {
+	return (packet->control.flags & PACKET_FLAG_OVERFLOW) != 0;
+}
+
 void freePacket(PACKET_PTR packet) {
+	if (packet && (packet->control.flags & PACKET_FLAG_EXTERNAL)) {
+		free(packet->data);
+	}
 	free(packet);
 }
 
 PACKET_PTR pPoke(PACKET_PTR packet, uint8_t achar) {
+	if (reservePacket(packet, 1)) {
+		return packet;
+	}
 	packet->data[packet->control.dataoffset++] = achar;
 	return packet;
 }
 
 PACKET_PTR pPokeMany(PACKET_PTR packet, const uint8_t * data, size_t length) {
+	if (reservePacket(packet, length)) {
+		return packet;
+	}
 	memcpy(&packet->data[packet->control.dataoffset], data, length);
 	packet->control.dataoffset += length;
 	return packet;
 }
 
+TLV_PTR startTLV(TLV_PTR tlv, PACKET_PTR packet, uint8_t type) {
+	tlv->type = type;
+	tlv->size = 0;
+	tlv->datastart = packet->control.dataoffset;
+	tlv->packet = pPokeMany(packet, (uint8_t *) "\x00\x00", 2);
+	return tlv;
+}
+
 TLV_PTR initTLV(PACKET_PTR packet, uint8_t type) {
 	TLV_PTR tlv = malloc(sizeof(TLV));
 	if (tlv) {
-		tlv->type = type;
-		tlv->datastart = packet->control.dataoffset;
-		tlv->packet = pPokeMany(packet, (uint8_t *) "\x00\x00", 2);
+		startTLV(tlv, packet, type);
 	}
 	return tlv;
 }
@@ -68,10 +132,17 @@ TLV_PTR tlvPoke(TLV_PTR tlv, uint8_t achar) {
 }
 
 TLV_PTR finalizeTLV(TLV_PTR tlv) {
+	if (packetOverflowed(tlv->packet)) {
+		return tlv;
+	}
 //compute size
 //the -2 is for the two header bytes
 	tlv->size = tlv->packet->control.dataoffset - tlv->datastart - 2;
-	tlv->size &= 0x01FF;
+	if (tlv->size > 0x01FF) {
+		//does not fit in the 9 bit length field
+		tlv->packet->control.flags |= PACKET_FLAG_OVERFLOW;
+		return tlv;
+	}
 //set up size on the original buffer
 	uint16_t * first = (uint16_t *) &tlv->packet->data[tlv->datastart];
 	(*first) = htons(tlv->size);
@@ -93,8 +164,8 @@ uint8_t getTLVType(TLV_PTR tlv) {
 }
 
 uint16_t parseTLVLength(uint8_t * data) {
-	uint16_t * size_p = (uint16_t *) data;
-	uint16_t length = ntohs((*size_p));
+	//byte by byte, tlvs are not aligned inside a frame
+	uint16_t length = (data[0] << 8) | data[1];
 	return length & 0x01FF;
 }
 
@@ -107,120 +178,120 @@ void freeTLV(TLV_PTR tlv) {
 }
 
 void createLastTLV(PACKET_PTR packet) {
-	TLV_PTR tlv = initTLV(packet, 0x0);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	TLV tlv;
+	startTLV(&tlv, packet, 0x0);
+	finalizeTLV(&tlv);
 }
 
 void createChasisIDTLV(PACKET_PTR packet, uint8_t type, uint8_t * data,
 		size_t length) {
-	TLV_PTR tlv = initTLV(packet, 1);
+	TLV tlv;
+	startTLV(&tlv, packet, 1);
 //TODO check type in 0-7
-	tlvPoke(tlv, type);
-	tlvPokeMany(tlv, data, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, type);
+	tlvPokeMany(&tlv, data, length);
+	finalizeTLV(&tlv);
 }
 
 void createPortIDTLV(PACKET_PTR packet, uint8_t type, uint8_t * data,
 		size_t length) {
-	TLV_PTR tlv = initTLV(packet, 2);
+	TLV tlv;
+	startTLV(&tlv, packet, 2);
 //TODO check type in 0-7
-	tlvPoke(tlv, type);
-	tlvPokeMany(tlv, data, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, type);
+	tlvPokeMany(&tlv, data, length);
+	finalizeTLV(&tlv);
 }
 
 void createTTLTLV(PACKET_PTR packet, uint16_t ttl) {
-	TLV_PTR tlv = initTLV(packet, 3);
+	TLV tlv;
+	startTLV(&tlv, packet, 3);
 	uint16_t toNetwork = htons(ttl);
-	tlvPokeMany(tlv, (uint8_t *) &toNetwork, 2);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPokeMany(&tlv, (uint8_t *) &toNetwork, 2);
+	finalizeTLV(&tlv);
 }
 
 void createPortDescriptionTLV(PACKET_PTR packet, uint8_t * data, size_t length) {
-	TLV_PTR tlv = initTLV(packet, 4);
-	tlvPokeMany(tlv, data, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	TLV tlv;
+	startTLV(&tlv, packet, 4);
+	tlvPokeMany(&tlv, data, length);
+	finalizeTLV(&tlv);
 }
 
 void createDeviceCategoryTLV(PACKET_PTR packet, uint8_t * deviveCategory,
 		size_t length) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1); //subtype
-	tlvPoke(tlv, 1); //device info id = 1;
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1); //subtype
+	tlvPoke(&tlv, 1); //device info id = 1;
 //TODO length check
-	tlvPoke(tlv, length);
-	tlvPokeMany(tlv, deviveCategory, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, length);
+	tlvPokeMany(&tlv, deviveCategory, length);
+	finalizeTLV(&tlv);
 }
 
 void createManufacturerCodeTLV(PACKET_PTR packet, uint8_t * manufacturerCode) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1); //subtype
-	tlvPoke(tlv, 2); //device info id = man code;
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1); //subtype
+	tlvPoke(&tlv, 2); //device info id = man code;
 //TODO length check == 6?
-	tlvPoke(tlv, 6);
-	tlvPokeMany(tlv, manufacturerCode, 6);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, 6);
+	tlvPokeMany(&tlv, manufacturerCode, 6);
+	finalizeTLV(&tlv);
 }
 
 void createModelNameTLV(PACKET_PTR packet, uint8_t * modelName, size_t length) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1); //subtype
-	tlvPoke(tlv, 3); //device info id = model name = 3;
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1); //subtype
+	tlvPoke(&tlv, 3); //device info id = model name = 3;
 //TODO length check
-	tlvPoke(tlv, length);
-	tlvPokeMany(tlv, modelName, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, length);
+	tlvPokeMany(&tlv, modelName, length);
+	finalizeTLV(&tlv);
 }
 void createModelNumberTLV(PACKET_PTR packet, uint8_t * modelNumber,
 		size_t length) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1); //subtype
-	tlvPoke(tlv, 4); //device info id = model name = 3;
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1); //subtype
+	tlvPoke(&tlv, 4); //device info id = model name = 3;
 //TODO length check <= 31
-	tlvPoke(tlv, length);
-	tlvPokeMany(tlv, modelNumber, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, length);
+	tlvPokeMany(&tlv, modelNumber, length);
+	finalizeTLV(&tlv);
 }
 
 void createOneByteTLV(PACKET_PTR packet, uint8_t id, uint8_t value) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1);
-	tlvPoke(tlv, id);
-	tlvPoke(tlv, 1); // one byte length
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1);
+	tlvPoke(&tlv, id);
+	tlvPoke(&tlv, 1); // one byte length
 	uint8_t val = value;
 	if (value > 100) {
 		val = 100;
 	}
-	tlvPoke(tlv, val);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, val);
+	finalizeTLV(&tlv);
 }
 
 void createMultiByteTLV(PACKET_PTR packet, uint8_t id, uint8_t size,
 		const uint8_t * data) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1);
-	tlvPoke(tlv, id);
-	tlvPoke(tlv, size); // one byte length
-	tlvPokeMany(tlv, data, size);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1);
+	tlvPoke(&tlv, id);
+	tlvPoke(&tlv, size); // one byte length
+	tlvPokeMany(&tlv, data, size);
+	finalizeTLV(&tlv);
 }
 
 void createChannelUseStateTLV(PACKET_PTR packet, uint8_t channelUsage) {
@@ -247,50 +318,50 @@ void createLLDPDUSendInterval(PACKET_PTR packet, uint16_t interval) {
 
 void createDeviceInfoEXTTLV(PACKET_PTR packet, uint8_t * orgCode,
 		uint8_t deviceInfoType, uint8_t * deviceInfo, uint8_t length) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 1);
-	tlvPoke(tlv, 255);
-	tlvPokeMany(tlv, (uint8_t *) orgCode, 6);
-	tlvPoke(tlv, deviceInfoType);
-	tlvPoke(tlv, length);
-	tlvPokeMany(tlv, deviceInfo, length);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 1);
+	tlvPoke(&tlv, 255);
+	tlvPokeMany(&tlv, (uint8_t *) orgCode, 6);
+	tlvPoke(&tlv, deviceInfoType);
+	tlvPoke(&tlv, length);
+	tlvPokeMany(&tlv, deviceInfo, length);
+	finalizeTLV(&tlv);
 }
 
 void createMacForwardingTLV(PACKET_PTR packet, uint8_t * ifType,
 		uint8_t ifLength, uint8_t * portNum, uint8_t portLength, uint8_t * macs,
 		uint8_t macLength) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 2);
-	tlvPoke(tlv, ifLength);
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 2);
+	tlvPoke(&tlv, ifLength);
 	switch (ifLength) {
 	case 1:
-		tlvPoke(tlv, ifType[0]);
+		tlvPoke(&tlv, ifType[0]);
 		break;
 	case 2: {
 		uint16_t twobyte = htons(*ifType);
-		tlvPokeMany(tlv, (uint8_t *) &twobyte, 2);
+		tlvPokeMany(&tlv, (uint8_t *) &twobyte, 2);
 	}
 		break;
 	case 4: {
 		uint32_t fourbyte = htonl(*ifType);
-		tlvPokeMany(tlv, (uint8_t *) &fourbyte, 4);
+		tlvPokeMany(&tlv, (uint8_t *) &fourbyte, 4);
 	}
 		break;
 	default:
 		//just copy whatever is there and pray
-		tlvPokeMany(tlv, ifType, ifLength);
+		tlvPokeMany(&tlv, ifType, ifLength);
 		break;
 	}
-	tlvPoke(tlv, portLength);
-	tlvPokeMany(tlv, portNum, portLength);
-	tlvPoke(tlv, macLength);
-	tlvPokeMany(tlv, macs, macLength * 6);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	tlvPoke(&tlv, portLength);
+	tlvPokeMany(&tlv, portNum, portLength);
+	tlvPoke(&tlv, macLength);
+	tlvPokeMany(&tlv, macs, macLength * 6);
+	finalizeTLV(&tlv);
 }
 
 void createMacForwardingTLVstruct(PACKET_PTR packet, MACFTLV_PTR macf) {
@@ -300,19 +371,20 @@ void createMacForwardingTLVstruct(PACKET_PTR packet, MACFTLV_PTR macf) {
 }
 
 void createMacEtherBridge(PACKET_PTR packet, uint8_t * macs, uint8_t macLength) {
-	TLV_PTR tlv = initTLV(packet, 127);
-	tlvPokeMany(tlv, TTC_OUI, 3);
-	tlvPoke(tlv, 3);
-	tlvPoke(tlv, macLength);
-	tlvPokeMany(tlv, macs, macLength * 6);
-	finalizeTLV(tlv);
-	freeTLV(tlv);
+	TLV tlv;
+	startTLV(&tlv, packet, 127);
+	tlvPokeMany(&tlv, TTC_OUI, 3);
+	tlvPoke(&tlv, 3);
+	tlvPoke(&tlv, macLength);
+	tlvPokeMany(&tlv, macs, macLength * 6);
+	finalizeTLV(&tlv);
 }
 
 //Extended
 
-TLV_PTR startExtendMacTlv(PACKET_PTR packet, uint8_t numberOfMacs) {
-	TLV_PTR tlv = initTLV(packet, 127);
+TLV_PTR startExtendMacTlv(TLV_PTR tlv, PACKET_PTR packet,
+		uint8_t numberOfMacs) {
+	startTLV(tlv, packet, 127);
 	tlvPokeMany(tlv, TTC_OUI, 3);
 	tlvPoke(tlv, 5);
 	tlvPoke(tlv, numberOfMacs);
@@ -326,11 +398,10 @@ void addExtendedMac(TLV_PTR tlv, uint8_t length, uint8_t * mac) {
 
 void endExtendedTlv(TLV_PTR tlv) {
 	finalizeTLV(tlv);
-	freeTLV(tlv);
 }
 
-TLV_PTR startExtendConnnectivityInformation(PACKET_PTR packet) {
-	TLV_PTR tlv = initTLV(packet, 127);
+TLV_PTR startExtendConnnectivityInformation(TLV_PTR tlv, PACKET_PTR packet) {
+	startTLV(tlv, packet, 127);
 	tlvPokeMany(tlv, TTC_OUI, 3);
 	tlvPoke(tlv, 4);
 	return tlv;
@@ -347,12 +418,14 @@ void addExtendedPortAndMacInfo(TLV_PTR tlv, uint8_t portLength,
 	}
 		break;
 	case 2: {
-		uint16_t num16 = portNum;
+		uint16_t num16 = htons(portNum);
 		tlvPokeMany(tlv, (uint8_t *) &num16, 2);
 	}
 		break;
-	case 4:
-		tlvPokeMany(tlv, (uint8_t *) &portNum, 4);
+	case 4: {
+		uint32_t num32 = htonl(portNum);
+		tlvPokeMany(tlv, (uint8_t *) &num32, 4);
+	}
 		break;
 	}
 	tlvPoke(tlv, macLength);
@@ -403,3 +476,121 @@ void addPerPortChannelInfo(TLV_PTR tlv, uint8_t channelNum,
 		tlvPokeMany(tlv, channelInfo, channelNum);
 	}
 }
+
+//Templates
+
+/** offset of the value inside an HTIP subtype 1 tlv: header(2) + OUI(3) + subtype + id + length */
+#define HTIPVALUEOFFSET 8
+
+void initTemplate(HTIPTEMPLATE_PTR tmpl, PACKET_PTR packet) {
+	memset(tmpl, 0, sizeof(HTIPTEMPLATE));
+	tmpl->packet = packet;
+}
+
+void templateEthernetHeader(HTIPTEMPLATE_PTR tmpl, const uint8_t * dst,
+		const uint8_t * src) {
+	const uint8_t ethlldp[] = { 0x88, 0xCC };
+	pPokeMany(tmpl->packet, dst, 6);
+	tmpl->srcOffset = tmpl->packet->control.dataoffset;
+	pPokeMany(tmpl->packet, src, 6);
+	pPokeMany(tmpl->packet, ethlldp, 2);
+}
+
+void templatePortIDTLV(HTIPTEMPLATE_PTR tmpl, uint8_t type, uint8_t * data,
+		size_t length) {
+	//header + port id type
+	tmpl->portIdOffset = tmpl->packet->control.dataoffset + 3;
+	tmpl->portIdLength = length;
+	createPortIDTLV(tmpl->packet, type, data, length);
+}
+
+void templateTTLTLV(HTIPTEMPLATE_PTR tmpl, uint16_t ttl) {
+	tmpl->ttlOffset = tmpl->packet->control.dataoffset + 2;
+	createTTLTLV(tmpl->packet, ttl);
+}
+
+void templateChannelUseStateTLV(HTIPTEMPLATE_PTR tmpl, uint8_t channelUsage) {
+	tmpl->channelUseStateOffset = tmpl->packet->control.dataoffset
+			+ HTIPVALUEOFFSET;
+	createChannelUseStateTLV(tmpl->packet, channelUsage);
+}
+
+void templateSignalStrengthTLV(HTIPTEMPLATE_PTR tmpl, uint8_t signalStrength) {
+	tmpl->signalStrengthOffset = tmpl->packet->control.dataoffset
+			+ HTIPVALUEOFFSET;
+	createSignalStrengthTLV(tmpl->packet, signalStrength);
+}
+
+void templateCommunicationErrorTLV(HTIPTEMPLATE_PTR tmpl, uint8_t error) {
+	tmpl->communicationErrorOffset = tmpl->packet->control.dataoffset
+			+ HTIPVALUEOFFSET;
+	createCommunicationErrorTLV(tmpl->packet, error);
+}
+
+void templateStatusInformationTLV(HTIPTEMPLATE_PTR tmpl, uint8_t size,
+		const uint8_t * data) {
+	tmpl->statusOffset = tmpl->packet->control.dataoffset + HTIPVALUEOFFSET;
+	tmpl->statusLength = size;
+	createStatusInformationTLV(tmpl->packet, size, data);
+}
+
+void templateLLDPDUSendInterval(HTIPTEMPLATE_PTR tmpl, uint16_t interval) {
+	tmpl->sendIntervalOffset = tmpl->packet->control.dataoffset
+			+ HTIPVALUEOFFSET;
+	createLLDPDUSendInterval(tmpl->packet, interval);
+}
+
+void patchSourceMac(HTIPTEMPLATE_PTR tmpl, const uint8_t * mac) {
+	if (tmpl->srcOffset) {
+		memcpy(&tmpl->packet->data[tmpl->srcOffset], mac, 6);
+	}
+}
+
+int patchPortID(HTIPTEMPLATE_PTR tmpl, const uint8_t * data, size_t length) {
+	if (!tmpl->portIdOffset || tmpl->portIdLength != length) {
+		return -1;
+	}
+	memcpy(&tmpl->packet->data[tmpl->portIdOffset], data, length);
+	return 0;
+}
+
+void patchTTL(HTIPTEMPLATE_PTR tmpl, uint16_t ttl) {
+	if (tmpl->ttlOffset) {
+		tmpl->packet->data[tmpl->ttlOffset] = ttl >> 8;
+		tmpl->packet->data[tmpl->ttlOffset + 1] = ttl & 0xFF;
+	}
+}
+
+void patchOneByte(HTIPTEMPLATE_PTR tmpl, size_t offset, uint8_t value) {
+	if (offset) {
+		tmpl->packet->data[offset] = value > 100 ? 100 : value;
+	}
+}
+
+void patchChannelUseState(HTIPTEMPLATE_PTR tmpl, uint8_t channelUsage) {
+	patchOneByte(tmpl, tmpl->channelUseStateOffset, channelUsage);
+}
+
+void patchSignalStrength(HTIPTEMPLATE_PTR tmpl, uint8_t signalStrength) {
+	patchOneByte(tmpl, tmpl->signalStrengthOffset, signalStrength);
+}
+
+void patchCommunicationError(HTIPTEMPLATE_PTR tmpl, uint8_t error) {
+	patchOneByte(tmpl, tmpl->communicationErrorOffset, error);
+}
+
+int patchStatusInformation(HTIPTEMPLATE_PTR tmpl, uint8_t size,
+		const uint8_t * data) {
+	if (!tmpl->statusOffset || tmpl->statusLength != size) {
+		return -1;
+	}
+	memcpy(&tmpl->packet->data[tmpl->statusOffset], data, size);
+	return 0;
+}
+
+void patchLLDPDUSendInterval(HTIPTEMPLATE_PTR tmpl, uint16_t interval) {
+	if (tmpl->sendIntervalOffset) {
+		tmpl->packet->data[tmpl->sendIntervalOffset] = interval >> 8;
+		tmpl->packet->data[tmpl->sendIntervalOffset + 1] = interval & 0xFF;
+	}
+}
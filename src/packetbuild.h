@@ -13,12 +13,55 @@
 #define __PACKETBUILD_H
 
 #include "structs.h"
+
+/** size of the block allocated by allocatePacket(), PACKET header included */
+#ifndef PACKET_DEFAULT_SIZE
+#define PACKET_DEFAULT_SIZE 1500
+#endif
+
+/** largest frame a packet may grow to, a 9000 byte jumbo payload plus ethernet and vlan headers */
+#ifndef PACKET_MAX_SIZE
+#define PACKET_MAX_SIZE 9018
+#endif
+
 /**
- * Initializes a PACKET_PTR with a buffer of 1500 bytes.
+ * When non-zero packets grow (doubling their capacity) when a write does not fit, otherwise the
+ * write is dropped and the packet is marked with PACKET_FLAG_OVERFLOW. Defaults to growing on host
+ * builds and to failing on microcontrollers.
+ */
+#ifndef PACKET_GROWABLE
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+#define PACKET_GROWABLE 1
+#else
+#define PACKET_GROWABLE 0
+#endif
+#endif
+
+/**
+ * Initializes a PACKET_PTR with a buffer of PACKET_DEFAULT_SIZE (1500) bytes.
  * @return a pointer to the PACKET structure that was initialized.
  */
 PACKET_PTR allocatePacket(void);
-//PACKET_PTR growPacket(PACKET_PTR packet);
+/**
+ * Initializes a PACKET_PTR with room for size bytes of frame data
+ * @param size the capacity of the packet, up to PACKET_MAX_SIZE
+ * @return a pointer to the PACKET structure that was initialized, or NULL
+ */
+PACKET_PTR allocatePacketSized(size_t size);
+/**
+ * Makes sure there is room for length more bytes in the packet, growing it if PACKET_GROWABLE is set.
+ * The PACKET structure itself never moves, only its data buffer.
+ * @param packet the packet to check
+ * @param length the number of bytes about to be written
+ * @return 0 if the bytes fit, -1 otherwise (the packet is then marked with PACKET_FLAG_OVERFLOW)
+ */
+int reservePacket(PACKET_PTR packet, size_t length);
+/**
+ * Checks if any write to the packet was dropped for lack of space. Such a frame is incomplete.
+ * @param packet the packet to check
+ * @return non-zero if the packet overflowed
+ */
+int packetOverflowed(PACKET_PTR packet);
 /**
  * Frees a packet that was created with allocatePacket()
  * @param packet The packet whose memory should be freed.
@@ -26,7 +69,7 @@ PACKET_PTR allocatePacket(void);
 void freePacket(PACKET_PTR packet);
 
 /**
- * Appends a single byte character to the frame
+ * Appends a single byte character to the frame. Writes that do not fit are dropped, see reservePacket()
  * @param packet the frame that the character will be appended to
  * @param achar the byte to add
  * @return a pointer to the frame
@@ -34,7 +77,8 @@ void freePacket(PACKET_PTR packet);
 PACKET_PTR pPoke(PACKET_PTR packet, uint8_t achar);
 
 /**
- * Appends a multi-byte sequence of characters to the frame
+ * Appends a multi-byte sequence of characters to the frame. Writes that do not fit are dropped, see
+ * reservePacket()
  * @param packet the frame to which the data will be appended
  * @param data pointer to the multi-byte sequencce
  * @param length the length of the multi-byte sequence
@@ -43,10 +87,20 @@ PACKET_PTR pPoke(PACKET_PTR packet, uint8_t achar);
 PACKET_PTR pPokeMany(PACKET_PTR packet, const uint8_t * data, size_t length);
 
 /**
- * Initialize a TLV
+ * Starts a TLV in caller-provided storage (typically on the stack). No memory is allocated,
+ * finalizeTLV() must still be called after the data has been appended.
+ * @param tlv the TLV structure that will keep track of this tlv
+ * @param packet the frame that this tlv will be appended to
+ * @param type the type of this tlv
+ * @return the TLV pointer that was passed in
+ */
+TLV_PTR startTLV(TLV_PTR tlv, PACKET_PTR packet, uint8_t type);
+
+/**
+ * Initialize a heap-allocated TLV. Prefer startTLV(), which does not allocate.
  * @param packet the frame that this tlv will be appended to
  * @param type the type of this tlv
- * @return a TLV structure pointer
+ * @return a TLV structure pointer, to be released with freeTLV()
  */
 TLV_PTR initTLV(PACKET_PTR packet, uint8_t type);
 
@@ -67,7 +121,8 @@ TLV_PTR tlvPoke(TLV_PTR tlv, uint8_t achar);
 TLV_PTR tlvPokeMany(TLV_PTR tlv, const uint8_t * data, size_t length);
 
 /**
- * Performs finalization of the given TLV. Must be called for each call to initTLV(), after data has been appended
+ * Performs finalization of the given TLV. Must be called for each call to initTLV(), after data has been appended.
+ * A TLV longer than 511 bytes cannot be encoded and marks the packet with PACKET_FLAG_OVERFLOW
  * @param tlv the TLV to finalize
  * @return the finalized TLV
  */
@@ -213,9 +268,13 @@ void createDeviceInfoEXTTLV(PACKET_PTR packet, uint8_t * orgCode,
 void createMacForwardingTLVstruct(PACKET_PTR packet, MACFTLV_PTR macf);
 
 /** start a TLV that holds the MAC addresses for extended connectivity information.
+ * @param tlv caller-provided storage for the tlv, usually a TLV on the stack
+ * @param packet the frame to add this tlv
+ * @param numberOfMacs the number of mac addresses that will be added
+ * @return the tlv pointer that was passed in
  * \sa addExtendedMac endExtendedTlv
  */
-TLV_PTR startExtendMacTlv(PACKET_PTR packet, uint8_t numberOfMacs);
+TLV_PTR startExtendMacTlv(TLV_PTR tlv, PACKET_PTR packet, uint8_t numberOfMacs);
 
 /** add a mac of variable size to the tlv that holds mac addresses
  * @param tlv a tlv initiated with startExtendMacTlv
@@ -233,15 +292,21 @@ void addExtendedMac(TLV_PTR tlv, uint8_t length, uint8_t * mac);
  */
 void endExtendedTlv(TLV_PTR tlv);
 
-/** starts a tlv that contains extended connectivity information (HTIP extension) */
-TLV_PTR startExtendConnnectivityInformation(PACKET_PTR packet);
+/** starts a tlv that contains extended connectivity information (HTIP extension)
+ * @param tlv caller-provided storage for the tlv, usually a TLV on the stack
+ * @param packet the frame to add this tlv
+ * @return the tlv pointer that was passed in
+ */
+TLV_PTR startExtendConnnectivityInformation(TLV_PTR tlv, PACKET_PTR packet);
 
 /** adds port length, port number, mac length, mac number and total number
  * of per host information occurences in an extended tlv
  *
  * @param tlv the extended tlv
  * @param portLength the length of a port entry, in bytes
- * @param portNum total port numbers
+ * @param portNum total port numbers, written in network order like every other multi-byte field.
+ * Older versions of the builder wrote 2 and 4 byte port numbers in host order, which a receiver reads as
+ * a different port on little-endian agents.
  * @param macLength the length of the mac address
  * @param macNum the total number of mac addresses
  * @param perHostInfoNum the total number of per host information occurences
@@ -291,4 +356,110 @@ void addPerPortPairedMacs(TLV_PTR tlv, uint8_t macNums, uint8_t macLength,
 void addPerPortChannelInfo(TLV_PTR tlv, uint8_t channelNum,
 		uint8_t * channelInfo);
 
+/**
+ * Initializes a frame template. The template takes ownership of the packet, build it up
+ * using the template*() functions below and the normal create*() functions for the static fields.
+ * Afterwards, only the recorded fields need to be patched before each send.
+ * @param tmpl the template to initialize
+ * @param packet an empty frame, as returned by allocatePacket()
+ */
+void initTemplate(HTIPTEMPLATE_PTR tmpl, PACKET_PTR packet);
+
+/**
+ * Appends the ethernet header for an LLDP frame and records the offset of the source mac address
+ * @param tmpl the template to add the header to
+ * @param dst the destination mac address (6 bytes)
+ * @param src the source mac address (6 bytes)
+ */
+void templateEthernetHeader(HTIPTEMPLATE_PTR tmpl, const uint8_t * dst,
+		const uint8_t * src);
+
+/**
+ * Same as createPortIDTLV() but records the offset of the port id
+ */
+void templatePortIDTLV(HTIPTEMPLATE_PTR tmpl, uint8_t type, uint8_t * data,
+		size_t length);
+
+/**
+ * Same as createTTLTLV() but records the offset of the Time To Live
+ */
+void templateTTLTLV(HTIPTEMPLATE_PTR tmpl, uint16_t ttl);
+
+/**
+ * Same as createChannelUseStateTLV() but records the offset of the channel usage
+ */
+void templateChannelUseStateTLV(HTIPTEMPLATE_PTR tmpl, uint8_t channelUsage);
+
+/**
+ * Same as createSignalStrengthTLV() but records the offset of the signal strength
+ */
+void templateSignalStrengthTLV(HTIPTEMPLATE_PTR tmpl, uint8_t signalStrength);
+
+/**
+ * Same as createCommunicationErrorTLV() but records the offset of the communication error
+ */
+void templateCommunicationErrorTLV(HTIPTEMPLATE_PTR tmpl, uint8_t error);
+
+/**
+ * Same as createStatusInformationTLV() but records the offset of the status information
+ */
+void templateStatusInformationTLV(HTIPTEMPLATE_PTR tmpl, uint8_t size,
+		const uint8_t * data);
+
+/**
+ * Same as createLLDPDUSendInterval() but records the offset of the send interval
+ */
+void templateLLDPDUSendInterval(HTIPTEMPLATE_PTR tmpl, uint16_t interval);
+
+/**
+ * Overwrites the source mac address of the template frame
+ * @param tmpl the template to patch
+ * @param mac the new source mac address (6 bytes)
+ */
+void patchSourceMac(HTIPTEMPLATE_PTR tmpl, const uint8_t * mac);
+
+/**
+ * Overwrites the port id of the template frame. The length cannot change in place.
+ * @param tmpl the template to patch
+ * @param data the new port id
+ * @param length the length of the new port id
+ * @return 0 on success, -1 if the length differs from the one in the template (the template must be rebuilt)
+ */
+int patchPortID(HTIPTEMPLATE_PTR tmpl, const uint8_t * data, size_t length);
+
+/**
+ * Overwrites the Time To Live of the template frame
+ */
+void patchTTL(HTIPTEMPLATE_PTR tmpl, uint16_t ttl);
+
+/**
+ * Overwrites the channel use state of the template frame (range: 0-100)
+ */
+void patchChannelUseState(HTIPTEMPLATE_PTR tmpl, uint8_t channelUsage);
+
+/**
+ * Overwrites the signal strength of the template frame (range: 0-100)
+ */
+void patchSignalStrength(HTIPTEMPLATE_PTR tmpl, uint8_t signalStrength);
+
+/**
+ * Overwrites the communication error of the template frame (range: 0-100)
+ */
+void patchCommunicationError(HTIPTEMPLATE_PTR tmpl, uint8_t error);
+
+/**
+ * Overwrites the status information of the template frame. The length cannot change in place.
+ * @param tmpl the template to patch
+ * @param size the length of the new status information
+ * @param data the new status information
+ * @return 0 on success, -1 if the length differs from the one in the template (the template must be rebuilt)
+ */
+int patchStatusInformation(HTIPTEMPLATE_PTR tmpl, uint8_t size,
+		const uint8_t * data);
+
+/**
+ * Overwrites the lldpdu send interval of the template frame
+ */
+void patchLLDPDUSendInterval(HTIPTEMPLATE_PTR tmpl, uint16_t interval);
+
 #endif
@@ -1,6 +1,5 @@
 #include <stdlib.h>
 #include <string.h>
-#include <lwip/def.h>
 #include "packetparse.h"
 #include "packetbuild.h"
 
@@ -10,314 +9,710 @@ int isFromSameSourceEther(HTIPPAYLOAD_PTR htipnew, HTIPPAYLOAD_PTR htipold) {
 	return (memcmp(headerOld->SRC, headerNew->SRC, 6));
 }
 
+SAMESOURCEFPTR sfptrs[] = { &isFromSameSourceEther };
+
 /////////////////////////////////////////////
 // Parsing and Printing related functions
 ////////////////////////////////////////////
 
+/** rounds arena allocations up so that every block is pointer aligned */
+#define ARENA_ALIGN(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+/**
+ * makes room for size more bytes in the arena. Only valid while nothing points into the arena but
+ * packet.data, which is moved along if the arena is reallocated.
+ */
+static int arenaReserve(HTIPPAYLOAD_PTR htip, size_t size) {
+	if (htip->arenaCapacity - htip->arenaSize >= size) {
+		return 0;
+	}
+	uint8_t * arena;
+	if (htip->arenaSize == 0) {
+		//nothing to keep
+		free(htip->arena);
+		arena = malloc(size);
+	} else {
+		arena = realloc(htip->arena, htip->arenaSize + size);
+	}
+	if (arena == NULL) {
+		if (htip->arenaSize == 0) {
+			htip->arena = NULL;
+			htip->arenaCapacity = 0;
+		}
+		return -1;
+	}
+	if (htip->packet.control.allocated) {
+		htip->packet.data = arena;
+	}
+	htip->arena = arena;
+	htip->arenaCapacity = htip->arenaSize + size;
+	return 0;
+}
+
+/** takes size bytes from the reserved arena space, NULL if there is not enough */
+static void * arenaAlloc(HTIPPAYLOAD_PTR htip, size_t size) {
+	size = ARENA_ALIGN(size);
+	if (htip->arenaCapacity - htip->arenaSize < size) {
+		return NULL;
+	}
+	void * block = &htip->arena[htip->arenaSize];
+	htip->arenaSize += size;
+	return block;
+}
+
 /** this relates to the parsing, be careful */
 void setHTIPdata(HTIPPAYLOAD_PTR htip, size_t size, uint8_t * data) {
-	htip->packet.data = malloc(size);
-	if (htip->packet.data) {
-		memcpy(htip->packet.data, data, size);
+	htip->arenaSize = 0;
+	htip->packet.control.allocated = 0;
+	//the frame goes first, parseLLDP() adds the records it counts after it
+	if (arenaReserve(htip, ARENA_ALIGN(size))) {
+		htip->packet.data = NULL;
+		htip->packet.control.dataoffset = 0;
+		return;
 	}
+	htip->packet.data = arenaAlloc(htip, size);
+	memcpy(htip->packet.data, data, size);
 	htip->packet.control.allocated = size;
 	htip->packet.control.dataoffset = size;
 }
 
-int checkAgainstTLVSize(uint8_t index, TLV_PTR tlv) {
-	return (int) tlv - index;
+void setHTIPview(HTIPPAYLOAD_PTR htip, size_t size, const uint8_t * data) {
+	htip->packet.data = (uint8_t *) data;
+	//nothing allocated, freeHTIP() leaves the data alone
+	htip->packet.control.allocated = 0;
+	htip->packet.control.dataoffset = size;
 }
 
-char parseHTIPSubtype4(TLV_PTR tlv, HTIPPAYLOAD_PTR htip) {
-	uint8_t subtype = tlv->data[5];
+void resetHTIP(HTIPPAYLOAD_PTR htip) {
+	uint8_t * arena = htip->arena;
+	size_t arenaCapacity = htip->arenaCapacity;
+	memset(htip, 0, sizeof(HTIPPAYLOAD));
+	htip->arena = arena;
+	htip->arenaCapacity = arenaCapacity;
+}
 
-	if (subtype != 4) {
-		//bad things happened. TODO
-		return -1;
+void tlvCursorInit(TLVCURSOR_PTR cursor, const uint8_t * data, size_t length) {
+	cursor->data = data;
+	cursor->length = length;
+	cursor->next = 0;
+}
+
+int tlvCursorNext(TLVCURSOR_PTR cursor, TLV_PTR tlv) {
+	size_t next = cursor->next;
+	if (next >= cursor->length) {
+		return 0;
 	}
-	uint8_t portLength = tlv->data[6];
-	uint32_t portNumber = 0;
-	uint8_t parseIndex = 6;
-	switch (portLength) {
+	if (cursor->length - next < 2) {
+		return -PARSE_ERR_TLV_HEADER;
+	}
+	uint8_t * data = (uint8_t *) &cursor->data[next];
+	tlv->data = data;
+	tlv->type = parseTLVType(data);
+	tlv->size = parseTLVLength(data);
+	tlv->datastart = next + 2;
+	if (cursor->length - tlv->datastart < tlv->size) {
+		return -PARSE_ERR_TLV_LENGTH;
+	}
+	cursor->next = tlv->datastart + tlv->size;
+	return 1;
+}
+
+/**
+ * returns non-zero if a field of length bytes starting at index (counted from the TLV header)
+ * does not fit in the tlv
+ */
+static inline int checkAgainstTLVSize(size_t index, size_t length, TLV_PTR tlv) {
+	return index + length > tlv->size + 2;
+}
+
+/** reads a 1, 2 or 4 byte network order integer, returns -1 for any other length */
+static int readNumber(const uint8_t * data, uint8_t length, uint32_t * number) {
+	switch (length) {
 	case 1:
-		portNumber = tlv->data[parseIndex];
-		break;
-	case 2: {
-		uint16_t * pNum = (uint16_t *) &tlv->data[parseIndex];
-		portNumber = ntohs(*pNum);
-	}
-		break;
-	case 4: {
-		uint32_t * pNum = (uint32_t *) &tlv->data[parseIndex];
-		portNumber = ntohl(*pNum);
-	}
-		break;
+		*number = data[0];
+		return 0;
+	case 2:
+		*number = ((uint32_t) data[0] << 8) | data[1];
+		return 0;
+	case 4:
+		*number = ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16)
+				| ((uint32_t) data[2] << 8) | data[3];
+		return 0;
 	default:
 		return -1;
 	}
-	parseIndex = 6 + portLength;
+}
+
+/** skips count length-prefixed fields, returns non-zero if they don't fit in the tlv */
+static int skipLengthPrefixed(TLV_PTR tlv, size_t * index, int count) {
+	for (int i = 0; i < count; i++) {
+		if (checkAgainstTLVSize(*index, 1, tlv)) {
+			return -1;
+		}
+		uint8_t length = tlv->data[(*index)++];
+		if (checkAgainstTLVSize(*index, length, tlv)) {
+			return -1;
+		}
+		*index += length;
+	}
+	return 0;
+}
+
+/** walks the extended connectivity tlv (subtype 4), piece gets the raw connectivity data */
+static PARSEERROR decodeHTIPSubtype4(TLV_PTR tlv, INFOPIECE_PTR piece) {
+	//port length, port number, mac length, mac number and per host info number
+	size_t parseIndex = 6;
+	if (checkAgainstTLVSize(parseIndex, 1, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	uint8_t portLength = tlv->data[parseIndex++];
+	if (portLength != 1 && portLength != 2 && portLength != 4) {
+		return PARSE_ERR_FIELD_VALUE;
+	}
+	if (checkAgainstTLVSize(parseIndex, portLength + 3, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	parseIndex += portLength;
 	uint8_t macLength = tlv->data[parseIndex++];
 	uint8_t macNum = tlv->data[parseIndex++];
 	uint8_t perHostInfos = tlv->data[parseIndex++];
-	uint8_t ssLength;
-	uint8_t ss; // signalStrength;
-	uint8_t epLength;
-	uint8_t ep; //error percentage;
-//parsing macs, signal strengths and error percentages
+//per host: mac address, signal strength, error percentage and unknown infos
 	for (int i = 0; i < macNum; i++) {
-		// TODO read mac address.
-		parseIndex += macLength;
-		ssLength = tlv->data[parseIndex++];
-		if (ssLength > 0) {
-			ss = tlv->data[parseIndex++];
+		if (checkAgainstTLVSize(parseIndex, macLength, tlv)) {
+			return PARSE_ERR_FIELD_LENGTH;
 		}
-		epLength = tlv->data[parseIndex++];
-		if (epLength > 0) {
-			ep = tlv->data[parseIndex++];
+		parseIndex += macLength;
+		if (skipLengthPrefixed(tlv, &parseIndex,
+				perHostInfos > 2 ? perHostInfos : 2)) {
+			return PARSE_ERR_FIELD_LENGTH;
 		}
-		if (checkAgainstTLVSize(parseIndex, tlv) > 0) {
+	}
+//per port: info number, paired macs, channel usage and unknown infos
+	if (checkAgainstTLVSize(parseIndex, 2, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	uint8_t perPortInfos = tlv->data[parseIndex++];
+	uint8_t perPortPairingNum = tlv->data[parseIndex++];
+	if (checkAgainstTLVSize(parseIndex, (size_t) perPortPairingNum * macLength,
+			tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	parseIndex += (size_t) perPortPairingNum * macLength;
+	if (skipLengthPrefixed(tlv, &parseIndex,
+			perPortInfos > 2 ? perPortInfos - 1 : 1)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+//a check for seeing whether we parsed the thing successfully or not
+	if (tlv->size + 2 != parseIndex) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	piece->info = &tlv->data[6];
+	piece->size = tlv->size - 4;
+	piece->acount = macNum;
+	return PARSE_OK;
+}
+
+/** reads a length-prefixed number, -1 if it is absent or not 1, 2 or 4 bytes long */
+static int16_t readInfoValue(const uint8_t * data, uint8_t length) {
+	uint32_t number;
+	if (readNumber(data, length, &number)) {
+		return -1;
+	}
+	return number > INT16_MAX ? INT16_MAX : (int16_t) number;
+}
+
+int decodeExtConnectivity(INFOPIECE_PTR raw, EXTCONNECTIVITY_PTR conn,
+		EXTHOST_PTR hosts, size_t capacity) {
+	const uint8_t * data = raw->info;
+	size_t size = raw->size;
+	size_t index = 0;
+	//nothing of a previous port may be left over if this fails
+	conn->raw = *raw;
+	conn->hostCount = 0;
+	conn->pairedCount = 0;
+	conn->channelCount = 0;
+	conn->hosts = hosts;
+	conn->pairedMacs = NULL;
+	conn->channelUsage = NULL;
+	//same layout that decodeHTIPSubtype4() checks, but this may be called on any buffer
+	if (index >= size) {
+		return -1;
+	}
+	uint8_t portLength = data[index++];
+	if (index + portLength + 3 > size) {
+		return -1;
+	}
+	if (readNumber(&data[index], portLength, &conn->portNumber)) {
+		return -1;
+	}
+	index += portLength;
+	conn->macLength = data[index++];
+	uint8_t hostCount = data[index++];
+	uint8_t perHostInfos = data[index++];
+	if (hostCount > capacity) {
+		return -1;
+	}
+	for (int i = 0; i < hostCount; i++) {
+		EXTHOST_PTR host = &conn->hosts[i];
+		host->port = 0;
+		if (index + conn->macLength > size) {
 			return -1;
 		}
-		if (perHostInfos > 2) {
-			uint8_t length;
-			//parse unknown stuff for the time being, just skip them
-			length = tlv->data[parseIndex++];
-			if (length > 0) {
-				parseIndex += length;
+		host->mac = &data[index];
+		index += conn->macLength;
+		host->signalStrength = -1;
+		host->errorRate = -1;
+		//signal strength, error percentage and infos nobody knows about
+		for (int info = 0; info < (perHostInfos > 2 ? perHostInfos : 2);
+				info++) {
+			if (index >= size) {
+				return -1;
 			}
-
-			if (checkAgainstTLVSize(parseIndex, tlv) > 0) {
+			uint8_t length = data[index++];
+			if (index + length > size) {
 				return -1;
 			}
-
+			if (info == 0) {
+				host->signalStrength = readInfoValue(&data[index], length);
+			} else if (info == 1) {
+				host->errorRate = readInfoValue(&data[index], length);
+			}
+			index += length;
 		}
 	}
-	uint8_t perPortInfos = tlv->data[parseIndex++];
-	uint8_t perPortPairingNum = tlv->data[parseIndex++];
-
-	if (checkAgainstTLVSize(parseIndex, tlv) > 0) {
+	if (index + 2 > size) {
 		return -1;
 	}
-
-	for (int i = 0; i < perPortPairingNum; i++) {
-		//TODO read paired mac addresses here
-		parseIndex += macLength;
+	uint8_t perPortInfos = data[index++];
+	conn->pairedCount = data[index++];
+	if (index + (size_t) conn->pairedCount * conn->macLength > size) {
+		return -1;
 	}
-	uint8_t channelLength = tlv->data[parseIndex++];
-	uint8_t channelUsage = -1;
-	if (channelLength > 0) {
-		channelUsage = tlv->data[parseIndex++];
+	conn->pairedMacs = &data[index];
+	index += (size_t) conn->pairedCount * conn->macLength;
+	//channel usage and infos nobody knows about
+	for (int info = 0; info < (perPortInfos > 2 ? perPortInfos - 1 : 1);
+			info++) {
+		if (index >= size) {
+			return -1;
+		}
+		uint8_t length = data[index++];
+		if (index + length > size) {
+			return -1;
+		}
+		if (info == 0) {
+			conn->channelCount = length;
+			conn->channelUsage = &data[index];
+		}
+		index += length;
 	}
+	conn->hostCount = hostCount;
+	return 0;
+}
 
-	if (checkAgainstTLVSize(parseIndex, tlv) > 0) {
-		return -1;
-	}
+/** counting sort bucket of a host: 100 - signal strength, hosts that didn't report one go last */
+static int signalBucket(EXTHOST_PTR host) {
+	int16_t signal = host->signalStrength;
+	return signal < 0 ? 101 : 100 - (signal > 100 ? 100 : signal);
+}
 
-//parse unknown per port infos
-	if (perPortInfos > 2) {
-		uint8_t length;
-		//parse unknown stuff for the time being, just skip them
-		length = tlv->data[parseIndex++];
-		if (length > 0) {
-			parseIndex += length;
+size_t extHostsBySignal(HTIPPAYLOAD_PTR htip, EXTHOST_PTR * sorted,
+		size_t max) {
+	size_t starts[103] = { 0 };
+	for (size_t port = 0; port < htip->connectivityCount; port++) {
+		EXTCONNECTIVITY_PTR conn = &htip->connectivity[port];
+		for (int i = 0; i < conn->hostCount; i++) {
+			starts[signalBucket(&conn->hosts[i]) + 1]++;
+		}
+	}
+	for (int bucket = 1; bucket < 103; bucket++) {
+		starts[bucket] += starts[bucket - 1];
+	}
+	for (size_t port = 0; port < htip->connectivityCount; port++) {
+		EXTCONNECTIVITY_PTR conn = &htip->connectivity[port];
+		for (int i = 0; i < conn->hostCount; i++) {
+			size_t position = starts[signalBucket(&conn->hosts[i])]++;
+			if (position < max) {
+				sorted[position] = &conn->hosts[i];
+			}
 		}
+	}
+	return starts[102] < max ? starts[102] : max;
+}
 
-		if (checkAgainstTLVSize(parseIndex, tlv) > 0) {
-			return -1;
+/** reads the mac forwarding table tlv (subtype 2) into macftlv */
+static PARSEERROR decodeMacForwardingTLV(TLV_PTR tlv, MACFTLV_PTR macftlv) {
+	//parse interface type and length
+	size_t index = 6;
+	if (checkAgainstTLVSize(index, 1, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	macftlv->ifLength = tlv->data[index++];
+	if (checkAgainstTLVSize(index, macftlv->ifLength + 1, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	if (readNumber(&tlv->data[index], macftlv->ifLength, &macftlv->ifType)) {
+		return PARSE_ERR_FIELD_VALUE;
+	}
+	index += macftlv->ifLength;
+	//parse port number and port length
+	macftlv->portLength = tlv->data[index++];
+	if (checkAgainstTLVSize(index, macftlv->portLength + 1, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	if (readNumber(&tlv->data[index], macftlv->portLength,
+			&macftlv->portNumber)) {
+		return PARSE_ERR_FIELD_VALUE;
+	}
+	index += macftlv->portLength;
+	macftlv->macLength = tlv->data[index++];
+	if (checkAgainstTLVSize(index, (size_t) macftlv->macLength * 6, tlv)) {
+		return PARSE_ERR_FIELD_LENGTH;
+	}
+	macftlv->macs = &tlv->data[index];
+	return PARSE_OK;
+}
+
+/** validates a TTC organizationally specific tlv and decodes its value */
+static PARSEERROR decodeHTIPSpecific(TLV_PTR tlv, TLVVALUE_PTR value) {
+	if (tlv->size < 4) {
+		return PARSE_ERR_TLV_TOO_SHORT;
+	}
+	if (memcmp(&tlv->data[2], TTC_OUI, 3)) {
+		//some other organization's tlv, not ours to check
+		return PARSE_OK;
+	}
+	value->subtype = tlv->data[5];
+	switch (value->subtype) {
+	case 1:
+		if (checkAgainstTLVSize(6, 2, tlv)
+				|| checkAgainstTLVSize(8, tlv->data[7], tlv)) {
+			return PARSE_ERR_FIELD_LENGTH;
 		}
+		value->piece.acount = tlv->data[6];
+		value->piece.size = tlv->data[7];
+		value->piece.info = &tlv->data[8];
+		return PARSE_OK;
+	case 2:
+		return decodeMacForwardingTLV(tlv, &value->macftlv);
+	case 3:
+		if (checkAgainstTLVSize(6, 1, tlv)
+				|| checkAgainstTLVSize(7, (size_t) tlv->data[6] * 6, tlv)) {
+			return PARSE_ERR_FIELD_LENGTH;
+		}
+		value->piece.acount = tlv->data[6];
+		value->piece.size = (size_t) tlv->data[6] * 6;
+		value->piece.info = &tlv->data[7];
+		return PARSE_OK;
+	case 4:
+		//this subtype... oh god...
+		return decodeHTIPSubtype4(tlv, &value->piece);
+	case 5: {
+		if (checkAgainstTLVSize(6, 1, tlv)) {
+			return PARSE_ERR_FIELD_LENGTH;
+		}
+		size_t index = 7;
+		if (skipLengthPrefixed(tlv, &index, tlv->data[6])) {
+			return PARSE_ERR_FIELD_LENGTH;
+		}
+		value->piece.acount = tlv->data[6];
+		value->piece.size = tlv->data[6] ? tlv->data[7] : 0;
+		value->piece.info = &tlv->data[8];
+	}
+		return PARSE_OK;
+	default:
+		return PARSE_OK; //things i don't know, handle them
+	}
+}
 
+/** minimum value lengths of the basic LLDP tlvs, indexed by type */
+static const uint8_t minTLVSize[9] = { 0, 2, 2, 2, 0, 0, 0, 0, 0 };
+
+PARSEERROR decodeTLV(TLV_PTR tlv, TLVVALUE_PTR value) {
+	value->subtype = 0;
+	if (tlv->type < sizeof(minTLVSize) && tlv->size < minTLVSize[tlv->type]) {
+		return PARSE_ERR_TLV_TOO_SHORT;
 	}
-//a check for seeing whether we parsed the thing successfully or not
-	if (tlv->size == parseIndex) {
-		return 0;
+	switch (tlv->type) {
+	case 1:
+	case 2:
+		value->piece.acount = tlv->data[2];
+		value->piece.info = &tlv->data[3];
+		value->piece.size = tlv->size - 1;
+		return PARSE_OK;
+	case 3:
+		value->piece.acount = (tlv->data[2] << 8) | tlv->data[3];
+		value->piece.info = 0;
+		value->piece.size = 2;
+		return PARSE_OK;
+	case 4:
+		value->piece.acount = 0;
+		value->piece.info = &tlv->data[2];
+		value->piece.size = tlv->size;
+		return PARSE_OK;
+	case 0:
+	case 5:
+	case 6:
+	case 7:
+	case 8:
+		return PARSE_OK;
+	case 127:
+		return decodeHTIPSpecific(tlv, value);
+	default:
+		return PARSE_ERR_UNKNOWN_TLV;
 	}
-	return 1;
 }
 
-void parseHTIPSpecific(TLV_PTR tlv, HTIPPAYLOAD_PTR htip) {
-	uint8_t subtype = tlv->data[5];
-	switch (subtype) {
-	case 1: {
-		uint8_t devInfo = tlv->data[6];
-		uint8_t infoSize = tlv->data[7];
-		uint8_t * infoData = &tlv->data[8];
-		switch (devInfo) {
+/** decodes an extended connectivity tlv into the next record, its hosts go to the free space of the arena */
+static PARSEERROR storeConnectivity(HTIPPAYLOAD_PTR htip, INFOPIECE_PTR raw) {
+	if (htip->connectivityCount == htip->connectivityCapacity) {
+		//reserveRecords() counted every tlv, only a failed reservation gets here
+		return PARSE_ERR_NO_MEMORY;
+	}
+	EXTCONNECTIVITY_PTR conn = &htip->connectivity[htip->connectivityCount];
+	EXTHOST_PTR hosts = (EXTHOST_PTR) &htip->arena[htip->arenaSize];
+	if (decodeExtConnectivity(raw, conn, hosts,
+			(htip->arenaCapacity - htip->arenaSize) / sizeof(EXTHOST))) {
+		return PARSE_ERR_NO_MEMORY;
+	}
+	arenaAlloc(htip, conn->hostCount * sizeof(EXTHOST));
+	for (int i = 0; i < conn->hostCount; i++) {
+		hosts[i].port = htip->connectivityCount;
+	}
+	htip->connectivityCount++;
+	return PARSE_OK;
+}
+
+/** stores a decoded HTIP tlv value in the payload */
+static PARSEERROR storeHTIPSpecific(HTIPPAYLOAD_PTR htip, TLVVALUE_PTR value) {
+	INFOPIECE_PTR target = NULL;
+	switch (value->subtype) {
+	case 1:
+		switch (value->piece.acount) {
 		case 1:
-			htip->deviceCategory.size = infoSize;
-			htip->deviceCategory.info = infoData;
+			target = &htip->deviceCategory;
 			break;
 		case 2:
-			htip->manufacturerCode.size = infoSize;
-			htip->manufacturerCode.info = infoData;
+			target = &htip->manufacturerCode;
 			break;
 		case 3:
-			htip->modelName.size = infoSize;
-			htip->modelName.info = infoData;
+			target = &htip->modelName;
 			break;
 		case 4:
-			htip->modelNumber.size = infoSize;
-			htip->modelNumber.info = infoData;
+			target = &htip->modelNumber;
 			break;
 		default:
 			//TODO add the rest optional subtype 1 tlvs
-			break;
+			return PARSE_OK;
+		}
+		target->size = value->piece.size;
+		target->info = value->piece.info;
+		return PARSE_OK;
+	case 2:
+		if (htip->portCount == htip->portCapacity) {
+			//reserveRecords() counted every tlv, only a failed reservation gets here
+			return PARSE_ERR_NO_MEMORY;
 		}
+		htip->macftlvs[htip->portCount++] = value->macftlv;
+		return PARSE_OK;
+	case 3:
+		htip->macs.acount = value->piece.acount;
+		htip->macs.info = value->piece.info;
+		return PARSE_OK;
+	case 4:
+		//already checked by decodeTLV(), this can only run out of arena
+		return storeConnectivity(htip, &value->piece);
+	case 5:
+		htip->extMacs = value->piece;
+		return PARSE_OK;
+	default:
+		return PARSE_OK;
 	}
-		return;	// case1 end
-	case 2: //TODO mac info
-	{
-		MACFTLV_PTR * macftlvindex;
-		//just get the last entry, and do nothing
+}
 
-		for (int i = 0; (macftlvindex = &htip->macftlvs[i]); i++) {
-			if (i >= MAXPORTS) {
-				return;
-			}
-			if ((*macftlvindex) == 0)
-				break;
-		}
-		(*macftlvindex) = malloc(sizeof(MACFTLV));
-		if (!(*macftlvindex)) {
-			return;
-		}
-		MACFTLV_PTR macftlv = (*macftlvindex);
-		memset(macftlv, 0, sizeof(MACFTLV));
-		//parse interface type and length
-		macftlv->ifLength = tlv->data[6];
-		switch (macftlv->ifLength) {
-		case 1:
-			macftlv->ifType = tlv->data[7];
-			break;
-		case 2: {
-			uint16_t * ifType = (uint16_t *) &tlv->data[7];
-			macftlv->ifType = ntohs(*ifType);
-		}
-			break;
-		case 4: {
-			uint32_t * ifType = (uint32_t *) &tlv->data[7];
-			macftlv->ifType = ntohl(*ifType);
-		}
-			break;
-		default:
-			return;
-		}
-		//parse port number and port length
-		uint32_t index = 7 + macftlv->ifLength;
-		macftlv->portLength = tlv->data[index];
-		index++;
-		switch (macftlv->portLength) {
-		case 1:
-			macftlv->portNumber = tlv->data[index];
-			break;
-		case 2: {
-			uint16_t * portNumber = (uint16_t *) &tlv->data[index];
-			macftlv->portNumber = ntohs(*portNumber);
-		}
-			break;
-		case 4: {
-			uint32_t * portNumber = (uint32_t *) &tlv->data[index];
-			macftlv->portNumber = ntohl(*portNumber);
+/** the PARSE_WANT_* bit of a tlv, 0 for tlvs that are never stored */
+static PARSEMASK wantedBit(TLV_PTR tlv) {
+	if (tlv->type >= 1 && tlv->type <= 4) {
+		return 1UL << tlv->type;
+	}
+	if (tlv->type != 127 || tlv->size < 4
+			|| memcmp(&tlv->data[2], TTC_OUI, 3)) {
+		return 0;
+	}
+	uint8_t subtype = tlv->data[5];
+	if (subtype == 1) {
+		if (tlv->size >= 5 && tlv->data[6] >= 1 && tlv->data[6] <= 4) {
+			return PARSE_WANT_DEVICEINFO(tlv->data[6]);
 		}
-			break;
-		default:
-			return;
+		return PARSE_WANT_OTHERS;
+	}
+	return subtype >= 2 && subtype <= 5 ? PARSE_WANT_SUBTYPE(subtype) : 0;
+}
+
+/** upper bound of the hosts of an extended connectivity tlv, each takes its mac and two info lengths */
+static size_t connectivityHosts(TLV_PTR tlv) {
+	//oui, subtype, port length, port number, mac length and host count
+	if (tlv->size < 5) {
+		return 0;
+	}
+	uint8_t portLength = tlv->data[6];
+	if (tlv->size < 7 + (size_t) portLength) {
+		return 0;
+	}
+	uint8_t macLength = tlv->data[7 + portLength];
+	uint8_t hostCount = tlv->data[8 + portLength];
+	size_t fits = tlv->size / ((size_t) macLength + 2);
+	return hostCount < fits ? hostCount : fits;
+}
+
+/**
+ * makes room in the arena for the records of the frame before any of them is stored, as the arena may
+ * move while it grows. The forwarding table ports, the extended connectivity records and their hosts
+ * are counted with a cursor pass over the frame, so the arena holds no more than the frame needs.
+ */
+static void reserveRecords(HTIPPAYLOAD_PTR htip, const uint8_t * data,
+		size_t length, PARSEMASK want) {
+	TLVCURSOR cursor;
+	TLV tlv;
+	size_t ports = 0;
+	size_t records = 0;
+	size_t hosts = 0;
+	tlvCursorInit(&cursor, data, length);
+	while (tlvCursorNext(&cursor, &tlv) > 0 && tlv.type != 0) {
+		PARSEMASK bit = wantedBit(&tlv) & want;
+		if (bit == PARSE_WANT_FORWARDINGTABLE) {
+			ports++;
+		} else if (bit == PARSE_WANT_EXTCONNECTIVITY) {
+			records++;
+			hosts += connectivityHosts(&tlv);
 		}
-		index = 8 + macftlv->ifLength + macftlv->portLength;
-		macftlv->macLength = tlv->data[index];
-		index++;
-		macftlv->macs = &tlv->data[index];
 	}
+	size_t portsSize = ARENA_ALIGN(ports * sizeof(MACFTLV));
+	size_t recordsSize = ARENA_ALIGN(records * sizeof(EXTCONNECTIVITY));
+	htip->portCount = 0;
+	htip->connectivityCount = 0;
+	if (arenaReserve(htip,
+			portsSize + recordsSize + ARENA_ALIGN(hosts * sizeof(EXTHOST)))) {
+		htip->portCapacity = 0;
+		htip->connectivityCapacity = 0;
 		return;
-	case 3:
-		htip->macs.acount = tlv->data[6];
-		htip->macs.info = &tlv->data[7];
-		return;
-	case 4:
-		//this subtype... oh god...
-		parseHTIPSubtype4(tlv, htip);
-		return;
-	case 5:
-		htip->extMacs.acount = tlv->data[6];
-		htip->extMacs.size = tlv->data[7];
-		htip->extMacs.info = &tlv->data[8];
-		return;
-	default:
-		return; //things i don't know, handle them
 	}
+	htip->macftlvs = ports ? arenaAlloc(htip, portsSize) : NULL;
+	htip->portCapacity = ports;
+	htip->connectivity = records ? arenaAlloc(htip, recordsSize) : NULL;
+	htip->connectivityCapacity = records;
 }
 
 HTIPPAYLOAD_PTR parseLLDP(HTIPPAYLOAD_PTR htip, uint8_t * indata,
 		size_t inlength) {
-	size_t next = 0;
-	uint8_t normal = 0;
+	return parseLLDPSelective(htip, indata, inlength, PARSE_WANT_ALL);
+}
+
+HTIPPAYLOAD_PTR parseLLDPSelective(HTIPPAYLOAD_PTR htip, uint8_t * indata,
+		size_t inlength, PARSEMASK want) {
+	PARSEERROR error = PARSE_OK;
 	uint8_t * data = indata;
 	size_t length = inlength;
+	TLVCURSOR cursor;
+	TLV tlv;
+	TLVVALUE value;
+	int next = 1;
+	uint8_t * offending = NULL;
+	PARSEMASK found = 0;
+	//forwarding tables, connectivity and other device information repeat, there is no telling when they are all found
+	int stopEarly = !(want
+			& (PARSE_WANT_FORWARDINGTABLE | PARSE_WANT_EXTCONNECTIVITY
+					| PARSE_WANT_OTHERS));
+	if (want & (PARSE_WANT_FORWARDINGTABLE | PARSE_WANT_EXTCONNECTIVITY)) {
+		//before data is taken from packet.data, the reservation may move it
+		if (htip->packet.data && htip->packet.control.dataoffset >= 14) {
+			reserveRecords(htip, htip->packet.data + 14,
+					htip->packet.control.dataoffset - 14, want);
+		} else if (!htip->packet.data) {
+			reserveRecords(htip, data, length, want);
+		}
+	}
 	if (htip->packet.data) {
+		if (htip->packet.control.dataoffset < sizeof(ETHHEADER)) {
+			error = PARSE_ERR_NO_DATA;
+			goto PARSEEND;
+		}
 		ETHHEADER_PTR ethheader = (ETHHEADER_PTR) htip->packet.data;
 		htip->src.info = ethheader->SRC;
 		htip->src.size = 6;
 		//if the actual packet data is set prefer that over indata
 		data = htip->packet.data + 14;
-		length = htip->packet.control.allocated - 14;
-	}
-	while (next < length) {
-		TLV_PTR tlv = parseFromData(&data[next]);
-		if (tlv == NULL)
-			return NULL;
-		switch (tlv->type) {
+		length = htip->packet.control.dataoffset - 14;
+	}
+	tlvCursorInit(&cursor, data, length);
+	while (!(stopEarly && (found & want) == want)
+			&& (next = tlvCursorNext(&cursor, &tlv)) > 0) {
+		offending = tlv.data;
+		PARSEMASK bit = wantedBit(&tlv);
+		if (bit && !(want & bit)) {
+			//not wanted, skip it by its length
+			continue;
+		}
+		found |= bit;
+		error = decodeTLV(&tlv, &value);
+		if (error != PARSE_OK) {
+			goto PARSEEND;
+		}
+		switch (tlv.type) {
 		case 1:
-			htip->chasisId.acount = tlv->data[2];
-			htip->chasisId.info = &tlv->data[3];
-			htip->chasisId.size = tlv->size - 1;
+			htip->chasisId = value.piece;
 			break;
 		case 2:
-			htip->portId.acount = tlv->data[2];
-			htip->portId.info = &tlv->data[3];
-			htip->portId.size = tlv->size - 1;
+			htip->portId = value.piece;
 			break;
-		case 3: {
-			uint16_t * ttlptr = (uint16_t *) &tlv->data[2];
-			htip->ttl.acount = ntohs(*ttlptr);
-			htip->ttl.info = 0;
-			htip->ttl.size = 2;
-		}
+		case 3:
+			htip->ttl = value.piece;
 			break;
 		case 4:
-			htip->portDescription.info = &tlv->data[2];
-			htip->portDescription.size = tlv->size;
-			htip->portDescription.acount = 0;
-			break;
-		case 5:
-		case 6:
-		case 7:
-		case 8:
-			htip->parseResult.size += 1;
+			htip->portDescription = value.piece;
 			break;
 		case 0:
-			normal = 1;
-			freeTLV(tlv);
 			goto PARSEEND;
 		case 127:
-			parseHTIPSpecific(tlv, htip);
+			error = storeHTIPSpecific(htip, &value);
+			if (error != PARSE_OK) {
+				goto PARSEEND;
+			}
 			break;
 		default:
-			goto PARSEEND;
+			htip->parseResult.size += 1;
+			break;
 		}
-		next += 2; //the size of a TLV header
-		next += tlv->size;
-		freeTLV(tlv);
 	}
-	PARSEEND: htip->parseResult.acount = normal;
+	if (next > 0) {
+		//every wanted field was found
+		error = PARSE_OK;
+		goto PARSEEND;
+	}
+	//either the frame ended without an end tlv, or the cursor ran out of the frame
+	error = next == 0 ? PARSE_ERR_NO_END : (PARSEERROR) -next;
+	offending = &data[cursor.next];
+	PARSEEND: htip->parseResult.info = error == PARSE_OK ? NULL : offending;
+	htip->parseError = error;
+	htip->parseResult.acount = error == PARSE_OK;
 	return htip;
 }
 
+/** prints a mac address of any length as colon separated hex */
+static void printMac(FILE * out, const uint8_t * mac, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		fprintf(out, i ? ":%02x" : "%02x", mac[i]);
+	}
+}
+
 void printHTIP(HTIPPAYLOAD_PTR htip, FILE * out) {
 	fprintf(out, "LLDP REPORT\n");
 	fprintf(out, "---------------\n");
 	fprintf(out, "Parse result: %s\n",
 			htip->parseResult.acount == 1 ? "GOOD" : "BAD");
 	if (htip->parseResult.acount != 1) {
-		fprintf(out, "bad packet picked up, stopping further processing\n");
+		fprintf(out,
+				"bad packet picked up (error %d), stopping further processing\n",
+				htip->parseError);
 		return;
 	}
 	fprintf(out, "Source MAC:");
@@ -357,37 +752,33 @@ void printHTIP(HTIPPAYLOAD_PTR htip, FILE * out) {
 		fprintf(out, "\n  Model Number: ");
 		fwrite(htip->modelNumber.info, htip->modelNumber.size, 1, out);
 	}
-	if (htip->macftlvs[0]) {
+	if (htip->portCount) {
 		fprintf(out, "\nBegin MAC forward TLVs\n");
 	} else {
 		goto PRINTEND;
 	}
-	for (int i = 0; i < MAXPORTS; i++) {
-		if (!htip->macftlvs[i]) {
-			fprintf(out, "\nEnd MAC forward TLVs");
-			break;
-		} else {
-			MACFTLV_PTR macftlv = htip->macftlvs[i];
-			fprintf(out, "iface type (length): %d\n", macftlv->ifLength);
-			fprintf(out, "iface type: %d\n", macftlv->ifType);
-			fprintf(out, "port number (length): %d\n", macftlv->portLength);
-			fprintf(out, "port number: %d\n", macftlv->portNumber);
-			fprintf(out, "number of mac addresses: %d\n", macftlv->macLength);
-			int index = 0;
-			while (index < macftlv->macLength) {
-				fprintf(out, " mac: ");
-				for (int i = 0; i < 6; i++) {
-					fprintf(out, "%2x", macftlv->macs[index * 6 + i]);
-					if (i != 5) {
-						fprintf(out, ":");
-					} else {
-						fprintf(out, "\n");
-					}
+	for (size_t i = 0; i < htip->portCount; i++) {
+		MACFTLV_PTR macftlv = &htip->macftlvs[i];
+		fprintf(out, "iface type (length): %d\n", macftlv->ifLength);
+		fprintf(out, "iface type: %d\n", macftlv->ifType);
+		fprintf(out, "port number (length): %d\n", macftlv->portLength);
+		fprintf(out, "port number: %d\n", macftlv->portNumber);
+		fprintf(out, "number of mac addresses: %d\n", macftlv->macLength);
+		int index = 0;
+		while (index < macftlv->macLength) {
+			fprintf(out, " mac: ");
+			for (int i = 0; i < 6; i++) {
+				fprintf(out, "%2x", macftlv->macs[index * 6 + i]);
+				if (i != 5) {
+					fprintf(out, ":");
+				} else {
+					fprintf(out, "\n");
 				}
-				index++;
 			}
+			index++;
 		}
 	}
+	fprintf(out, "\nEnd MAC forward TLVs");
 	PRINTEND: fprintf(out, "\n------END------\n");
 	if (htip->macs.info && htip->macs.acount != 0) {
 		fprintf(out, "HTIP-ethernet bridge mac addresses: %d\n",
@@ -404,19 +795,41 @@ void printHTIP(HTIPPAYLOAD_PTR htip, FILE * out) {
 			}
 		}
 	}
+	for (size_t port = 0; port < htip->connectivityCount; port++) {
+		EXTCONNECTIVITY_PTR conn = &htip->connectivity[port];
+		fprintf(out, "HTIP extended connectivity, port %u: %d hosts\n",
+				conn->portNumber, conn->hostCount);
+		for (int index = 0; index < conn->hostCount; index++) {
+			fprintf(out, "  host: ");
+			printMac(out, conn->hosts[index].mac, conn->macLength);
+			fprintf(out, " signal strength: %d error rate: %d\n",
+					conn->hosts[index].signalStrength,
+					conn->hosts[index].errorRate);
+		}
+		for (int index = 0; index < conn->pairedCount; index++) {
+			fprintf(out, "  paired mac: ");
+			printMac(out, &conn->pairedMacs[index * conn->macLength],
+					conn->macLength);
+			fprintf(out, "\n");
+		}
+		if (conn->channelCount) {
+			fprintf(out, "  channel usage:");
+			for (int index = 0; index < conn->channelCount; index++) {
+				fprintf(out, " %d", conn->channelUsage[index]);
+			}
+			fprintf(out, "\n");
+		}
+	}
+}
+
+void releaseHTIP(HTIPPAYLOAD_PTR htip) {
+	//the frame copy, the ports and the extended connectivity live in the arena
+	free(htip->arena);
+	memset(htip, 0, sizeof(HTIPPAYLOAD));
 }
 
 void freeHTIP(HTIPPAYLOAD_PTR htip) {
-	if (htip->packet.data) {
-		free(htip->packet.data);
-	}
-	for (int i = 0; i < MAXPORTS; i++) {
-		if (!htip->macftlvs[i]) {
-			break;
-		} else {
-			free(htip->macftlvs[i]);
-		}
-	}
+	releaseHTIP(htip);
 	free(htip);
 }
 
@@ -424,120 +837,151 @@ void freeHTIP(HTIPPAYLOAD_PTR htip) {
 // JSON related functions
 ////////////////////////////////
 
-void putInfopiece(INFOPIECE_PTR buffer, INFOPIECE_PTR info, char * tag) {
+/** writes an INFOPIECE as a string value, if it is present */
+static void putInfopiece(JSONWRITER_PTR writer, INFOPIECE_PTR info,
+		const char * tag) {
 	if (info->info) {
-		buffer->size += sprintf((char *) buffer->info + buffer->size,
-				"\"%s\":\"", tag);
-		memcpy(buffer->info + buffer->size, info->info, info->size);
-		buffer->size += info->size;
-		if (buffer->info[buffer->size - 1] == 0) {
-			buffer->size--;
-		}
-		buffer->size += sprintf((char *) buffer->info + buffer->size, "\",\n");
+		jsonKey(writer, tag);
+		jsonString(writer, info->info, info->size);
 	}
 }
-void putMac(INFOPIECE_PTR buffer, uint8_t * mac) {
-	for (int i = 0; i < 6; i++) {
-		buffer->size += sprintf((char *) buffer->info + buffer->size, "%02x",
-				mac[i]);
-		if (i != 5) {
-			buffer->info[buffer->size] = ':';
-			buffer->size++;
-		}
-	}
-}
-
-void putMacTLVs(INFOPIECE_PTR buffer, MACFTLV_PTR mactable) {
-	if (mactable) {
-		buffer->size += sprintf((char *) buffer->info + buffer->size, "{\n");
-		buffer->size += sprintf((char *) buffer->info + buffer->size,
-				"\"interfaceType\":\"%d", mactable->ifType);
-		buffer->size += sprintf((char *) buffer->info + buffer->size, "\",\n");
-		buffer->size += sprintf((char *) buffer->info + buffer->size,
-				"\"portNumber\":\"%d", mactable->portNumber);
-		buffer->size += sprintf((char *) buffer->info + buffer->size, "\",\n");
-		buffer->size += sprintf((char *) buffer->info + buffer->size,
-				"\"macentries\":[\n");
-		for (int i = 0; i < mactable->macLength; i++) {
-			buffer->info[buffer->size++] = '"';
-			putMac(buffer, &mactable->macs[i * 6]);
-			buffer->info[buffer->size++] = '"';
-			if (i != mactable->macLength - 1) {
-				buffer->size += sprintf((char *) buffer->info + buffer->size,
-						",\n");
-			} else {
-				buffer->size += sprintf((char *) buffer->info + buffer->size,
-						"]\n");
-			}
+
+/** writes an LLDP id (chassis or port id) and its subtype, mac address ids are written as such */
+static void putLLDPId(JSONWRITER_PTR writer, INFOPIECE_PTR info,
+		uint8_t macSubtype, const char * tag, const char * typeTag) {
+	if (info->info) {
+		jsonKey(writer, tag);
+		if (info->acount == macSubtype && info->size == 6) {
+			jsonMac(writer, info->info, 6);
+		} else {
+			jsonString(writer, info->info, info->size);
 		}
-		buffer->size += sprintf((char *) buffer->info + buffer->size, "},\n");
+		jsonKey(writer, typeTag);
+		jsonUInt(writer, info->acount);
 	}
 }
 
-int getMacAsString(char * dst, uint8_t * mac) {
-	int index = 0;
+/** writes an array of 6-byte mac addresses */
+static void putMacList(JSONWRITER_PTR writer, const char * tag,
+		const uint8_t * macs, size_t count) {
+	jsonKey(writer, tag);
+	jsonBeginArray(writer);
+	for (size_t i = 0; i < count; i++) {
+		jsonMac(writer, &macs[i * 6], 6);
+	}
+	jsonEndArray(writer);
+}
 
-	uint8_t res = 0;
-	uint8_t rem = 0;
-	for (int i = 0; i < 6; i++) {
-		res = mac[i] / 16;
-		rem = mac[i] % 16;
-		if (res < 10) {
-			dst[index++] = '0' + res;
-		} else {
-			dst[index++] = 'A' + res - 10;
+static void putMacTLV(JSONWRITER_PTR writer, MACFTLV_PTR mactable) {
+	jsonBeginObject(writer);
+	jsonKey(writer, "interfaceType");
+	jsonUIntString(writer, mactable->ifType);
+	jsonKey(writer, "portNumber");
+	jsonUIntString(writer, mactable->portNumber);
+	putMacList(writer, "macentries", mactable->macs, mactable->macLength);
+	jsonEndObject(writer);
+}
+
+/** writes a reported value, values that were not reported are left out */
+static void putReported(JSONWRITER_PTR writer, const char * tag, int16_t value) {
+	if (value >= 0) {
+		jsonKey(writer, tag);
+		jsonUInt(writer, value);
+	}
+}
+
+static void putConnectivity(JSONWRITER_PTR writer, EXTCONNECTIVITY_PTR conn) {
+	jsonBeginObject(writer);
+	jsonKey(writer, "portNumber");
+	jsonUIntString(writer, conn->portNumber);
+	jsonKey(writer, "hosts");
+	jsonBeginArray(writer);
+	for (int i = 0; i < conn->hostCount; i++) {
+		jsonBeginObject(writer);
+		jsonKey(writer, "mac");
+		jsonMac(writer, conn->hosts[i].mac, conn->macLength);
+		putReported(writer, "signalStrength", conn->hosts[i].signalStrength);
+		putReported(writer, "errorRate", conn->hosts[i].errorRate);
+		jsonEndObject(writer);
+	}
+	jsonEndArray(writer);
+	jsonKey(writer, "pairedMacs");
+	jsonBeginArray(writer);
+	for (int i = 0; i < conn->pairedCount; i++) {
+		jsonMac(writer, &conn->pairedMacs[i * conn->macLength],
+				conn->macLength);
+	}
+	jsonEndArray(writer);
+	jsonKey(writer, "channelUsage");
+	jsonBeginArray(writer);
+	for (int i = 0; i < conn->channelCount; i++) {
+		jsonUInt(writer, conn->channelUsage[i]);
+	}
+	jsonEndArray(writer);
+	jsonEndObject(writer);
+}
+
+void writeHTIPJSON(HTIPPAYLOAD_PTR htip, JSONWRITER_PTR writer) {
+	jsonBeginObject(writer);
+	if (htip->src.info) {
+		jsonKey(writer, "src");
+		jsonMac(writer, htip->src.info, 6);
+	}
+	jsonKey(writer, "parseResult");
+	jsonUInt(writer, htip->parseResult.acount);
+	if (htip->parseError != PARSE_OK) {
+		jsonKey(writer, "parseError");
+		jsonUInt(writer, htip->parseError);
+	}
+	putLLDPId(writer, &htip->chasisId, 4, "chasisId", "chasisIdType");
+	putLLDPId(writer, &htip->portId, 3, "portId", "portIdType");
+	if (htip->ttl.size) {
+		jsonKey(writer, "ttl");
+		jsonUIntString(writer, htip->ttl.acount);
+	}
+	putInfopiece(writer, &htip->portDescription, "portDescription");
+	putInfopiece(writer, &htip->deviceCategory, "deviceCategory");
+	putInfopiece(writer, &htip->manufacturerCode, "manufacturerCode");
+	putInfopiece(writer, &htip->modelName, "modelName");
+	putInfopiece(writer, &htip->modelNumber, "modelNumber");
+	if (htip->portCount) {
+		jsonKey(writer, "forwardingTable");
+		jsonBeginArray(writer);
+		for (size_t i = 0; i < htip->portCount; i++) {
+			putMacTLV(writer, &htip->macftlvs[i]);
 		}
-		if (rem < 10) {
-			dst[index++] = '0' + rem;
-		} else {
-			dst[index++] = 'A' + rem - 10;
+		jsonEndArray(writer);
+	}
+	if (htip->macs.info && htip->macs.acount) {
+		putMacList(writer, "macs", htip->macs.info, htip->macs.acount);
+	}
+	if (htip->extMacs.info && htip->extMacs.acount) {
+		//length-prefixed addresses, info points past the first length
+		const uint8_t * entry = htip->extMacs.info - 1;
+		jsonKey(writer, "extMacs");
+		jsonBeginArray(writer);
+		for (uint32_t i = 0; i < htip->extMacs.acount; i++) {
+			jsonMac(writer, &entry[1], entry[0]);
+			entry += 1 + entry[0];
 		}
-		if (i != 5) {
-			dst[index++] = ':';
-		} else {
-			dst[index++] = '\0';
+		jsonEndArray(writer);
+	}
+	if (htip->connectivityCount) {
+		jsonKey(writer, "extConnectivity");
+		jsonBeginArray(writer);
+		for (size_t i = 0; i < htip->connectivityCount; i++) {
+			putConnectivity(writer, &htip->connectivity[i]);
 		}
+		jsonEndArray(writer);
 	}
-	//don't count the final closing \0
-	return index - 1;
+	jsonEndObject(writer);
 }
 
 char * AsJSON(HTIPPAYLOAD_PTR htip) {
-	unsigned char * json = malloc(2048);
-	INFOPIECE buffer;
-	buffer.size = 0;
-	buffer.info = json;
-	if (!json) {
+	JSONWRITER writer;
+	if (jsonInitBuffer(&writer, 1024)) {
 		return NULL;
 	}
-	buffer.size += sprintf((char *) buffer.info + buffer.size, "{\n");
-	char macbuffer[20]; //it should be 17
-	getMacAsString(macbuffer, htip->src.info);
-	buffer.size += sprintf((char *) buffer.info + buffer.size,
-			"\"src\":\"%s\",\n", macbuffer);
-	putInfopiece(&buffer, &htip->chasisId, "chasisId");
-	putInfopiece(&buffer, &htip->portId, "portId");
-	if (htip->ttl.acount) {
-		buffer.size += sprintf((char *) buffer.info + buffer.size,
-				"\"ttl\":\"%d\",\n", htip->ttl.acount);
-	}
-	putInfopiece(&buffer, &htip->portDescription, "portDescription");
-	putInfopiece(&buffer, &htip->deviceCategory, "deviceCategory");
-	putInfopiece(&buffer, &htip->manufacturerCode, "manufacturerCode");
-	putInfopiece(&buffer, &htip->modelName, "modelName");
-	putInfopiece(&buffer, &htip->modelNumber, "modelNumber");
-	if (htip->macftlvs[0]) {
-		buffer.size += sprintf((char *) buffer.info + buffer.size,
-				"\"forwardingTable\":[\n");
-		for (int i = 0; i < MAXPORTS; i++) {
-			putMacTLVs(&buffer, htip->macftlvs[i]);
-		}
-		//remove the last ",\n" from the buffer and replace it
-		buffer.size -= 2;
-		buffer.size += sprintf((char *) buffer.info + buffer.size, "]\n");
-	}
-
-	buffer.size += sprintf((char *) buffer.info + buffer.size, "}");
-	return (char *) buffer.info;
+	writeHTIPJSON(htip, &writer);
+	return jsonFinish(&writer);
 }
-
@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include "structs.h"
+#include "jsonwriter.h"
 
 /**
  * Checks if two packets are from the same source
@@ -16,21 +17,144 @@
 int isFromSameSourceEther(HTIPPAYLOAD_PTR htipnew, HTIPPAYLOAD_PTR htipold);
 /**
  * Copies data to the internal storage of the htip structure. Must be called after allocating htip.
- * all the INFOPIECE entries of this htip will be pointing to the newly copied data
+ * all the INFOPIECE entries of this htip will be pointing to the newly copied data. The copy goes to the
+ * arena of the payload, parseLLDP() grows it by the room the forwarding table and the extended
+ * connectivity of the frame need, so the arena is the only allocation a parsed frame needs (and none if
+ * the arena of a reset payload is already big enough). On failure htip->packet.data is NULL.
  * @param htip htip payload structure to be initialized with the data
  * @param size size of the data
- * @param data the original data that will be copied
+ * @param data the original data that will be copied, the whole frame starting at the ethernet header
+ * (parseLLDP() takes htip->src from it)
  */
 void setHTIPdata(HTIPPAYLOAD_PTR htip, size_t size, uint8_t * data);
+/**
+ * Same as setHTIPdata() but the data is borrowed instead of copied. The data must stay valid for as long
+ * as the htip structure is in use, and freeHTIP() will not free it.
+ * @param htip htip payload structure to be initialized with the data
+ * @param size size of the data
+ * @param data the frame that the INFOPIECE entries of this htip will point to, starting at the ethernet
+ * header like for setHTIPdata()
+ */
+void setHTIPview(HTIPPAYLOAD_PTR htip, size_t size, const uint8_t * data);
+/**
+ * Empties a payload so that another frame can be parsed into it, keeping its arena. A collector that
+ * resets its payloads instead of freeing them doesn't allocate anything once the arenas are big enough.
+ * Parsing allocates even for borrowed frames (see setHTIPview()), so a payload must be reset rather than
+ * zeroed between frames, and released with releaseHTIP() or freeHTIP() at the end.
+ * @param htip the payload to reset
+ */
+void resetHTIP(HTIPPAYLOAD_PTR htip);
+/**
+ * Sets up a cursor over a buffer of TLVs. Nothing is copied or allocated.
+ * @param cursor the cursor to initialize, usually on the stack
+ * @param data start of the first TLV
+ * @param length number of bytes available in data
+ */
+void tlvCursorInit(TLVCURSOR_PTR cursor, const uint8_t * data, size_t length);
+/**
+ * Reads the next TLV of the cursor into tlv. On success tlv->data points to the TLV header inside
+ * the borrowed buffer, tlv->size is the length of the TLV value and tlv->datastart its offset.
+ * @param cursor the cursor to advance
+ * @param tlv where the TLV will be stored, usually on the stack
+ * @return 1 if a TLV was read, 0 at the end of the buffer, -PARSE_ERR_TLV_HEADER or -PARSE_ERR_TLV_LENGTH if
+ * the TLV runs past the end of the buffer
+ */
+int tlvCursorNext(TLVCURSOR_PTR cursor, TLV_PTR tlv);
+/**
+ * Validates a TLV read by tlvCursorNext() and decodes its value, without storing it anywhere. This is the
+ * TLV dispatch shared by parseLLDP() and the batch parser.
+ * @param tlv the TLV to decode
+ * @param value filled in with the decoded value, pointing into the TLV data
+ * @return PARSE_OK, or the reason the TLV is malformed
+ */
+PARSEERROR decodeTLV(TLV_PTR tlv, TLVVALUE_PTR value);
+/** most hosts an extended connectivity tlv can hold, its host count is one byte */
+#define EXTCONNECTIVITY_MAXHOSTS 255
+/**
+ * Decodes the raw extended connectivity information of a port (EXTCONNECTIVITY::raw, or a port read with
+ * htipViewNextConnectivity()) into hosts and port information. parseLLDP() already does this for every
+ * port, see HTIPPAYLOAD::connectivity.
+ * @param raw the raw information, starting at the port length
+ * @param conn filled in with the decoded information, conn->raw is set to raw and its hosts are written
+ * to hosts
+ * @param hosts room for the hosts, a tlv has at most EXTCONNECTIVITY_MAXHOSTS
+ * @param capacity the number of hosts that fit in hosts
+ * @return 0 on success, -1 if the information is malformed or has more than capacity hosts
+ */
+int decodeExtConnectivity(INFOPIECE_PTR raw, EXTCONNECTIVITY_PTR conn,
+		EXTHOST_PTR hosts, size_t capacity);
+/**
+ * Orders the hosts of extended connectivity information by signal strength, strongest first. Hosts that
+ * didn't report a signal strength go last, hosts with the same strength keep their frame order. The
+ * hosts of all ports are ordered together, EXTHOST::port tells which port a host belongs to.
+ * @param htip a payload parsed with PARSE_WANT_EXTCONNECTIVITY
+ * @param sorted filled in with pointers to the strongest hosts
+ * @param max the number of entries sorted can hold
+ * @return the number of hosts written to sorted
+ */
+size_t extHostsBySignal(HTIPPAYLOAD_PTR htip, EXTHOST_PTR * sorted,
+		size_t max);
 /**
  * Parses a raw data buffer into an HTIPPAYLOAD structure.
  * @param htip a pointer to the HTIPPAYLOAD structure which the data will be parsed into
  * @param data WARNING, READ THIS CAREFULLY: points to the exact start of the LLDP frame BUT: if the
  * htip structure has already used the function setHTIPData(), this argument will be ignored!
  * @param length the length of the lldp frame (will also be ignored if setHTIPData() was used)
- * @return the htip payload pointer with the information fields populated
+ * @return the htip payload pointer with the information fields populated. Every TLV and field length is
+ * checked against the TLV and the frame, on failure htip->parseError tells why and htip->parseResult.info
+ * points to the offending TLV. htip->src is only set for frames given with setHTIPdata() or setHTIPview(),
+ * data has no ethernet header to take it from and leaves it NULL.
  */
 HTIPPAYLOAD_PTR parseLLDP(HTIPPAYLOAD_PTR htip, uint8_t * data, size_t length);
+
+/** LLDP chasis id (type 1) */
+#define PARSE_WANT_CHASISID (1UL << 1)
+/** LLDP port id (type 2) */
+#define PARSE_WANT_PORTID (1UL << 2)
+/** LLDP Time To Live (type 3) */
+#define PARSE_WANT_TTL (1UL << 3)
+/** LLDP port description (type 4) */
+#define PARSE_WANT_PORTDESCRIPTION (1UL << 4)
+/** HTIP device information (subtype 1) with the given id, 1 to 4 */
+#define PARSE_WANT_DEVICEINFO(id) (1UL << (8 + (id)))
+#define PARSE_WANT_DEVICECATEGORY PARSE_WANT_DEVICEINFO(1)
+#define PARSE_WANT_MANUFACTURERCODE PARSE_WANT_DEVICEINFO(2)
+#define PARSE_WANT_MODELNAME PARSE_WANT_DEVICEINFO(3)
+#define PARSE_WANT_MODELNUMBER PARSE_WANT_DEVICEINFO(4)
+/** HTIP subtype 2 to 5, forwarding table, bridge macs, extended connectivity and extended macs */
+#define PARSE_WANT_SUBTYPE(subtype) (1UL << (11 + (subtype)))
+#define PARSE_WANT_FORWARDINGTABLE PARSE_WANT_SUBTYPE(2)
+#define PARSE_WANT_MACS PARSE_WANT_SUBTYPE(3)
+#define PARSE_WANT_EXTCONNECTIVITY PARSE_WANT_SUBTYPE(4)
+#define PARSE_WANT_EXTMACS PARSE_WANT_SUBTYPE(5)
+/** HTIP device information that is not stored anywhere, wanting it only checks it */
+#define PARSE_WANT_OTHERS (1UL << 17)
+
+/** who is alive: the source mac address (decoded whenever the ethernet header is there) and the TTL */
+#define PARSE_WANT_LIVENESS PARSE_WANT_TTL
+/** what is it: device category, manufacturer code, model name and number */
+#define PARSE_WANT_INVENTORY (PARSE_WANT_DEVICECATEGORY | PARSE_WANT_MANUFACTURERCODE \
+		| PARSE_WANT_MODELNAME | PARSE_WANT_MODELNUMBER)
+/** who is connected where: the forwarding tables */
+#define PARSE_WANT_TOPOLOGY PARSE_WANT_FORWARDINGTABLE
+/** everything, parseLLDPSelective() behaves as parseLLDP() */
+#define PARSE_WANT_ALL ((PARSEMASK) 0x3FE1E)
+
+/**
+ * Same as parseLLDP() but only the fields in want are decoded, the other TLVs are skipped by their length
+ * without being looked at. Parsing stops as soon as every wanted field is found (never when the forwarding
+ * table, the extended connectivity or PARSE_WANT_OTHERS is wanted, they have no fixed number of TLVs). The
+ * first occurrence of a field is kept when parsing stops early, the last one otherwise. Skipped TLVs and the
+ * TLVs after an early stop are not checked, so a frame that fails parseLLDP() may parse fine here. The source
+ * mac address is set whenever the frame was given with setHTIPdata() or setHTIPview().
+ * @param htip a pointer to the HTIPPAYLOAD structure which the data will be parsed into
+ * @param data the LLDP frame, ignored if setHTIPdata() was used (see parseLLDP())
+ * @param length the length of the lldp frame, ignored if setHTIPdata() was used
+ * @param want the fields to decode, PARSE_WANT_* bits
+ * @return the htip payload pointer with the wanted fields populated
+ */
+HTIPPAYLOAD_PTR parseLLDPSelective(HTIPPAYLOAD_PTR htip, uint8_t * data,
+		size_t length, PARSEMASK want);
 /**
  * Prints the HTIPPAYLOAD structure to the stream out, in a human readable form
  * @param htip the payload to print
@@ -38,17 +162,31 @@ HTIPPAYLOAD_PTR parseLLDP(HTIPPAYLOAD_PTR htip, uint8_t * data, size_t length);
  */
 void printHTIP(HTIPPAYLOAD_PTR htip, FILE * out);
 /**
- * Frees an HTIPPAYLOAD structure and all its fields, including the copied data from the original frame
+ * Frees what a payload allocated (its arena) but not the structure itself, which is zeroed. Use it for
+ * payloads on the stack or embedded in other structures.
+ * @param htip the payload to release
+ */
+void releaseHTIP(HTIPPAYLOAD_PTR htip);
+/**
+ * Frees an HTIPPAYLOAD structure and its arena, which holds all its fields including the copied data
+ * from the original frame
  * @param htip a pointer to the structure whose memory will be freed
  */
 void freeHTIP(HTIPPAYLOAD_PTR htip);
 /**
  * Allocates a character buffer that contains the HTIPPAYLOAD information in JSON format (don't forget to free the buffer
- * afterwards)
+ * afterwards). The buffer grows to fit the whole payload.
  * @param htip the structure that will be represented as JSON
- * @return a character buffer with the JSON data
+ * @return a character buffer with the JSON data, or NULL if an allocation failed
  */
 char * AsJSON(HTIPPAYLOAD_PTR htip);
+/**
+ * Writes the HTIPPAYLOAD information in JSON format to a writer. Use this with a sink writer
+ * (see jsonInitSink()) to stream the output without building it in memory.
+ * @param htip the structure that will be represented as JSON
+ * @param writer the writer to write to
+ */
+void writeHTIPJSON(HTIPPAYLOAD_PTR htip, JSONWRITER_PTR writer);
 
 /**
  * definition for functions that check if two packets are from the same source
@@ -60,7 +198,7 @@ typedef int (*SAMESOURCEFPTR)(HTIPPAYLOAD_PTR, HTIPPAYLOAD_PTR);
  * When GRE extension with IPv6 is implemented, a "same source" function for IPv6 must be
  * added to this table
  */
-SAMESOURCEFPTR sfptrs[] = { &isFromSameSourceEther };
+extern SAMESOURCEFPTR sfptrs[];
 
 /**
  * Internal use
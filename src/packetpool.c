@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <string.h>
+#include "packetpool.h"
+
+/** slots are kept aligned so the PACKET header of each one is naturally aligned */
+#define SLOTALIGN 16
+
+#define HEADINDEX(head) \
+	((uint32_t) ((head) & (((POOLWORD) 1 << POOLHEAD_INDEXBITS) - 1)))
+#define HEADTAG(head) ((head) >> POOLHEAD_INDEXBITS)
+//the tag wraps around, its bits past the word are dropped
+#define MAKEHEAD(tag, index) (((POOLWORD) (tag) << POOLHEAD_INDEXBITS) | (index))
+
+PACKETPOOL_PTR createPacketPool(size_t slots, size_t slotSize) {
+	if (slots == 0 || slots > PACKETPOOL_MAXSLOTS) {
+		return NULL;
+	}
+	PACKETPOOL_PTR pool = malloc(sizeof(PACKETPOOL));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->slots = slots;
+	pool->slotSize = slotSize;
+	pool->stride = (sizeof(PACKET) + slotSize + SLOTALIGN - 1)
+			& ~(size_t) (SLOTALIGN - 1);
+	pool->memory = malloc(pool->stride * slots);
+	pool->next = malloc(sizeof(POOLLINK) * slots);
+	if (pool->memory == NULL || pool->next == NULL) {
+		free(pool->memory);
+		free(pool->next);
+		free(pool);
+		return NULL;
+	}
+	//chain all slots: slot i points to slot i + 1
+	for (size_t i = 0; i < slots; i++) {
+		pool->next[i] = i + 1 < slots ? i + 2 : 0;
+	}
+	pool->head = MAKEHEAD(0, 1);
+	return pool;
+}
+
+void destroyPacketPool(PACKETPOOL_PTR pool) {
+	if (pool) {
+		free(pool->memory);
+		free(pool->next);
+		free(pool);
+	}
+}
+
+PACKET_PTR poolAcquire(PACKETPOOL_PTR pool) {
+	uint32_t index;
+#ifndef __STDC_NO_ATOMICS__
+	POOLWORD head = atomic_load_explicit(&pool->head, memory_order_acquire);
+	do {
+		index = HEADINDEX(head);
+		if (index == 0) {
+			return NULL;
+		}
+		//a stale next is harmless, the tag makes the exchange fail
+	} while (!atomic_compare_exchange_weak_explicit(&pool->head, &head,
+			MAKEHEAD(HEADTAG(head) + 1,
+					atomic_load_explicit(&pool->next[index - 1], memory_order_relaxed)),
+			memory_order_acquire, memory_order_acquire));
+#else
+	PACKETPOOL_LOCK();
+	index = HEADINDEX(pool->head);
+	if (index != 0) {
+		pool->head = MAKEHEAD(0, pool->next[index - 1]);
+	}
+	PACKETPOOL_UNLOCK();
+	if (index == 0) {
+		return NULL;
+	}
+#endif
+	PACKET_PTR packet = (PACKET_PTR) (pool->memory
+			+ (size_t) (index - 1) * pool->stride);
+	//only the control structure is reset, the data will be overwritten anyway
+	memset(&packet->control, 0, sizeof(PACKETCONTROL));
+	packet->control.allocated = pool->slotSize;
+	packet->data = (uint8_t *) packet + sizeof(PACKET);
+	return packet;
+}
+
+void poolRelease(PACKETPOOL_PTR pool, PACKET_PTR packet) {
+	if (packet->control.flags & PACKET_FLAG_EXTERNAL) {
+		//the packet grew out of its slot
+		free(packet->data);
+	}
+	uint32_t index = ((uint8_t *) packet - pool->memory) / pool->stride + 1;
+#ifndef __STDC_NO_ATOMICS__
+	POOLWORD head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+	do {
+		atomic_store_explicit(&pool->next[index - 1], HEADINDEX(head),
+				memory_order_relaxed);
+	} while (!atomic_compare_exchange_weak_explicit(&pool->head, &head,
+			MAKEHEAD(HEADTAG(head) + 1, index), memory_order_release,
+			memory_order_relaxed));
+#else
+	PACKETPOOL_LOCK();
+	pool->next[index - 1] = HEADINDEX(pool->head);
+	pool->head = MAKEHEAD(0, index);
+	PACKETPOOL_UNLOCK();
+#endif
+}
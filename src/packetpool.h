@@ -0,0 +1,85 @@
+/**
+ * \file
+ * \brief fixed-slot pool of PACKET buffers
+ *
+ * A pool carves one allocation into equally sized PACKET slots that can be acquired and released
+ * in O(1) without touching the allocator. Use it for the send loop or for the receive path, where
+ * a received frame is copied into a pooled packet and then handed to setHTIPview() and parseLLDP().
+ *
+ * The free list is lock-free when C11 atomics are available, so a pool can be shared between the
+ * threads of a host collector. The head of the list is a single pointer-sized word, so that 32-bit
+ * targets without a 64-bit compare and swap (Cortex-M) don't need libatomic. Without atomics (__STDC_NO_ATOMICS__ defined) define PACKETPOOL_LOCK() and
+ * PACKETPOOL_UNLOCK() (e.g. to taskENTER_CRITICAL()/taskEXIT_CRITICAL()) if the pool is shared.
+ */
+#ifndef __PACKETPOOL_H
+#define __PACKETPOOL_H
+
+#include "structs.h"
+
+/** head of the free list: slot index + 1 in the low half, ABA tag in the high half */
+#if UINTPTR_MAX > UINT32_MAX
+typedef uint64_t POOLWORD;
+#define POOLHEAD_INDEXBITS 32
+#else
+typedef uint32_t POOLWORD;
+#define POOLHEAD_INDEXBITS 16
+#endif
+/** most slots a pool can have, index + 1 has to fit in the low half of the head */
+#define PACKETPOOL_MAXSLOTS (((POOLWORD) 1 << POOLHEAD_INDEXBITS) - 2)
+
+#ifndef __STDC_NO_ATOMICS__
+#include <stdatomic.h>
+typedef _Atomic POOLWORD POOLHEAD;
+/** free list link of a slot */
+typedef _Atomic uint32_t POOLLINK;
+#else
+typedef POOLWORD POOLHEAD;
+typedef uint32_t POOLLINK;
+#ifndef PACKETPOOL_LOCK
+#define PACKETPOOL_LOCK()
+#define PACKETPOOL_UNLOCK()
+#endif
+#endif
+
+/**
+ * A pool of equally sized packets, created with createPacketPool()
+ */
+typedef struct {
+	size_t slots; /*!< number of packets in the pool */
+	size_t slotSize; /*!< usable data bytes of each packet */
+	size_t stride; /*!< distance in bytes between two slots */
+	uint8_t * memory; /*!< the slots, each one a PACKET followed by its data */
+	POOLLINK * next; /*!< free list links, index + 1 of the next free slot (0 ends the list) */
+	POOLHEAD head; /*!< first free slot */
+} PACKETPOOL, *PACKETPOOL_PTR;
+
+/**
+ * Creates a pool of packets with a single allocation
+ * @param slots the number of packets in the pool, at most PACKETPOOL_MAXSLOTS (65534 on 32-bit targets)
+ * @param slotSize the data bytes of each packet (1500 for normal frames, up to 9000 for jumbo frames)
+ * @return the pool, or NULL if the allocation failed
+ */
+PACKETPOOL_PTR createPacketPool(size_t slots, size_t slotSize);
+
+/**
+ * Frees a pool created with createPacketPool(). Packets still acquired become invalid.
+ * @param pool the pool to free
+ */
+void destroyPacketPool(PACKETPOOL_PTR pool);
+
+/**
+ * Takes an empty packet from the pool. The data buffer is not cleared.
+ * @param pool the pool to take the packet from
+ * @return an empty packet, or NULL if all packets are in use
+ */
+PACKET_PTR poolAcquire(PACKETPOOL_PTR pool);
+
+/**
+ * Returns a packet taken with poolAcquire() to its pool. If the packet grew out of its slot
+ * (see reservePacket()), the grown buffer is freed.
+ * @param pool the pool the packet was taken from
+ * @param packet the packet to return
+ */
+void poolRelease(PACKETPOOL_PTR pool, PACKET_PTR packet);
+
+#endif
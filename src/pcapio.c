@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pcapio.h"
+#include "packetparse.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PCAPIO_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/** classic pcap magic numbers, as read in the byte order of the file */
+#define PCAP_MAGIC_MICROS 0xA1B2C3D4
+#define PCAP_MAGIC_NANOS 0xA1B23C4D
+/** pcapng block types */
+#define PCAPNG_SECTION_HEADER 0x0A0D0D0A
+#define PCAPNG_INTERFACE 0x00000001
+#define PCAPNG_SIMPLE_PACKET 0x00000003
+#define PCAPNG_ENHANCED_PACKET 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+/** pcapng if_tsresol option */
+#define PCAPNG_OPTION_TSRESOL 9
+/** ethernet link type */
+#define LINKTYPE_ETHERNET 1
+
+static uint16_t read16(const uint8_t * data, int bigEndian) {
+	if (bigEndian) {
+		return (data[0] << 8) | data[1];
+	}
+	return (data[1] << 8) | data[0];
+}
+
+static uint32_t read32(const uint8_t * data, int bigEndian) {
+	if (bigEndian) {
+		return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16)
+				| ((uint32_t) data[2] << 8) | data[3];
+	}
+	return ((uint32_t) data[3] << 24) | ((uint32_t) data[2] << 16)
+			| ((uint32_t) data[1] << 8) | data[0];
+}
+
+/** converts a timestamp in if_tsresol units to nanoseconds */
+static uint64_t toNanos(uint64_t timestamp, uint8_t resolution) {
+	uint8_t exponent = resolution & 0x7F;
+	if (resolution & 0x80) {
+		//negative power of two, readInterfaceOptions() keeps the exponent under 64
+		uint64_t fraction = timestamp & ((1ULL << exponent) - 1);
+		if (exponent > 32) {
+			//drop the bits under 2^-32 seconds so that the product fits
+			fraction >>= exponent - 32;
+			return (timestamp >> exponent) * 1000000000ULL
+					+ ((fraction * 1000000000ULL) >> 32);
+		}
+		return (timestamp >> exponent) * 1000000000ULL
+				+ ((fraction * 1000000000ULL) >> exponent);
+	}
+	while (exponent < 9) {
+		timestamp *= 10;
+		exponent++;
+	}
+	while (exponent > 9) {
+		timestamp /= 10;
+		exponent--;
+	}
+	return timestamp;
+}
+
+static int isLLDPFrame(const uint8_t * data, size_t length) {
+	return length >= sizeof(ETHHEADER) && data[12] == 0x88 && data[13] == 0xCC;
+}
+
+static int mapFile(PCAPREADER_PTR reader, const char * path) {
+#ifdef PCAPIO_MMAP
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) || st.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+	void * map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	reader->data = map;
+	reader->size = st.st_size;
+	return 0;
+#else
+	FILE * file = fopen(path, "rb");
+	long size;
+	uint8_t * data;
+	if (file == NULL) {
+		return -1;
+	}
+	if (fseek(file, 0, SEEK_END) || (size = ftell(file)) <= 0
+			|| fseek(file, 0, SEEK_SET) || (data = malloc(size)) == NULL) {
+		fclose(file);
+		return -1;
+	}
+	if (fread(data, 1, size, file) != (size_t) size) {
+		free(data);
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+	reader->data = data;
+	reader->size = size;
+	return 0;
+#endif
+}
+
+int pcapOpen(PCAPREADER_PTR reader, const char * path) {
+	memset(reader, 0, sizeof(PCAPREADER));
+	if (mapFile(reader, path)) {
+		return -1;
+	}
+	if (reader->size >= 24) {
+		uint32_t magic = read32(reader->data, 0);
+		if (magic == PCAP_MAGIC_MICROS || magic == PCAP_MAGIC_NANOS) {
+			reader->bigEndian = 0;
+		} else {
+			magic = read32(reader->data, 1);
+			reader->bigEndian = 1;
+		}
+		if (magic == PCAP_MAGIC_MICROS || magic == PCAP_MAGIC_NANOS) {
+			reader->format = PCAP_FORMAT_PCAP;
+			reader->interfaces = 1;
+			reader->linkType[0] = read32(&reader->data[20], reader->bigEndian);
+			reader->resolution[0] = magic == PCAP_MAGIC_NANOS ? 9 : 6;
+			reader->offset = 24;
+			return 0;
+		}
+	}
+	if (reader->size >= 12
+			&& read32(reader->data, 0) == PCAPNG_SECTION_HEADER) {
+		//the section header block sets the byte order, pcapNext() reads it
+		reader->format = PCAP_FORMAT_PCAPNG;
+		return 0;
+	}
+	pcapClose(reader);
+	return -1;
+}
+
+/** reads the next pcap record, returns 1 if frame was filled in */
+static int nextPcapRecord(PCAPREADER_PTR reader, PCAPFRAME_PTR frame) {
+	const uint8_t * record = &reader->data[reader->offset];
+	if (reader->size - reader->offset < 16) {
+		return -1;
+	}
+	uint32_t captured = read32(&record[8], reader->bigEndian);
+	if (captured > reader->size - reader->offset - 16) {
+		return -1;
+	}
+	reader->offset += 16 + captured;
+	frame->frame.data = &record[16];
+	frame->frame.length = captured;
+	frame->originalLength = read32(&record[12], reader->bigEndian);
+	frame->interface = 0;
+	frame->timestamp = (uint64_t) read32(record, reader->bigEndian)
+			* 1000000000ULL
+			+ toNanos(read32(&record[4], reader->bigEndian),
+					reader->resolution[0]);
+	return 1;
+}
+
+/** reads the options of an interface block, returns -1 if the resolution can't be used */
+static int readInterfaceOptions(PCAPREADER_PTR reader, const uint8_t * block,
+		uint32_t length, uint32_t interface) {
+	uint32_t offset = 16;
+	while (offset + 4 <= length - 4) {
+		uint16_t code = read16(&block[offset], reader->bigEndian);
+		uint16_t optionLength = read16(&block[offset + 2], reader->bigEndian);
+		offset += 4;
+		if (code == 0 || optionLength > length - 4 - offset) {
+			return 0;
+		}
+		if (code == PCAPNG_OPTION_TSRESOL && optionLength >= 1) {
+			if ((block[offset] & 0x80) && (block[offset] & 0x7F) > 63) {
+				//finer than 2^-63 seconds doesn't fit a 64-bit timestamp
+				return -1;
+			}
+			reader->resolution[interface] = block[offset];
+		}
+		offset += (optionLength + 3) & ~3u;
+	}
+	return 0;
+}
+
+/** reads the next pcapng block, returns 1 if it was a packet block and frame was filled in */
+static int nextPcapngBlock(PCAPREADER_PTR reader, PCAPFRAME_PTR frame) {
+	const uint8_t * block = &reader->data[reader->offset];
+	size_t available = reader->size - reader->offset;
+	if (available < 12) {
+		return -1;
+	}
+	uint32_t type = read32(block, reader->bigEndian);
+	if (type == PCAPNG_SECTION_HEADER) {
+		uint32_t magic = read32(&block[8], 0);
+		if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+			reader->bigEndian = 0;
+		} else if (read32(&block[8], 1) == PCAPNG_BYTE_ORDER_MAGIC) {
+			reader->bigEndian = 1;
+		} else {
+			return -1;
+		}
+		reader->interfaces = 0;
+	}
+	uint32_t length = read32(&block[4], reader->bigEndian);
+	if (length < 12 || (length & 3) || length > available) {
+		return -1;
+	}
+	reader->offset += length;
+	switch (type) {
+	case PCAPNG_INTERFACE:
+		if (length < 20) {
+			return -1;
+		}
+		if (reader->interfaces < PCAP_MAXINTERFACES) {
+			reader->linkType[reader->interfaces] = read16(&block[8],
+					reader->bigEndian);
+			reader->resolution[reader->interfaces] = 6;
+			if (readInterfaceOptions(reader, block, length,
+					reader->interfaces)) {
+				return -1;
+			}
+		}
+		reader->interfaces++;
+		return 0;
+	case PCAPNG_ENHANCED_PACKET: {
+		if (length < 32) {
+			return -1;
+		}
+		uint32_t captured = read32(&block[20], reader->bigEndian);
+		if (captured > length - 32) {
+			return -1;
+		}
+		frame->interface = read32(&block[8], reader->bigEndian);
+		if (frame->interface >= reader->interfaces
+				|| frame->interface >= PCAP_MAXINTERFACES) {
+			return 0;
+		}
+		frame->frame.data = &block[28];
+		frame->frame.length = captured;
+		frame->originalLength = read32(&block[24], reader->bigEndian);
+		frame->timestamp = toNanos(
+				((uint64_t) read32(&block[12], reader->bigEndian) << 32)
+						| read32(&block[16], reader->bigEndian),
+				reader->resolution[frame->interface]);
+	}
+		return 1;
+	case PCAPNG_SIMPLE_PACKET:
+		if (length < 16 || reader->interfaces == 0) {
+			return length < 16 ? -1 : 0;
+		}
+		frame->interface = 0;
+		frame->originalLength = read32(&block[8], reader->bigEndian);
+		frame->frame.data = &block[12];
+		frame->frame.length =
+				frame->originalLength < length - 16 ?
+						frame->originalLength : length - 16;
+		frame->timestamp = 0;
+		return 1;
+	default:
+		//statistics, name resolution and everything else
+		return 0;
+	}
+}
+
+int pcapNext(PCAPREADER_PTR reader, PCAPFRAME_PTR frame) {
+	while (reader->offset < reader->size) {
+		int result =
+				reader->format == PCAP_FORMAT_PCAP ?
+						nextPcapRecord(reader, frame) :
+						nextPcapngBlock(reader, frame);
+		if (result < 0) {
+			//don't read past a malformed record
+			reader->offset = reader->size;
+			return -1;
+		}
+		if (result && reader->linkType[frame->interface] == LINKTYPE_ETHERNET
+				&& isLLDPFrame(frame->frame.data, frame->frame.length)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+size_t pcapNextBatch(PCAPREADER_PTR reader, FRAMEVIEW * frames, size_t count) {
+	PCAPFRAME frame;
+	size_t read = 0;
+	while (read < count && pcapNext(reader, &frame) == 1) {
+		frames[read++] = frame.frame;
+	}
+	return read;
+}
+
+int pcapParseNext(PCAPREADER_PTR reader, HTIPPAYLOAD_PTR htip,
+		PARSEMASK want) {
+	PCAPFRAME frame;
+	int result = pcapNext(reader, &frame);
+	if (result == 1) {
+		setHTIPview(htip, frame.frame.length, frame.frame.data);
+		parseLLDPSelective(htip, NULL, 0, want);
+		htip->recvTime = frame.timestamp / 1000000000ULL;
+	}
+	return result;
+}
+
+void pcapClose(PCAPREADER_PTR reader) {
+	if (reader->data) {
+#ifdef PCAPIO_MMAP
+		munmap((void *) reader->data, reader->size);
+#else
+		free((void *) reader->data);
+#endif
+	}
+	reader->data = NULL;
+	reader->size = 0;
+	reader->offset = 0;
+}
+
+/** writes a 32 bit value in host order, as the pcap format expects */
+static void put32(uint8_t * data, uint32_t value) {
+	memcpy(data, &value, 4);
+}
+
+static void put16(uint8_t * data, uint16_t value) {
+	memcpy(data, &value, 2);
+}
+
+int pcapCreate(PCAPWRITER_PTR writer, const char * path) {
+	uint8_t header[24];
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL) {
+		return -1;
+	}
+	put32(&header[0], PCAP_MAGIC_MICROS);
+	put16(&header[4], 2);
+	put16(&header[6], 4);
+	put32(&header[8], 0);
+	put32(&header[12], 0);
+	put32(&header[16], 65535);
+	put32(&header[20], LINKTYPE_ETHERNET);
+	if (fwrite(header, sizeof(header), 1, writer->file) != 1) {
+		pcapCloseWriter(writer);
+		return -1;
+	}
+	return 0;
+}
+
+int pcapWrite(PCAPWRITER_PTR writer, const uint8_t * data, size_t length,
+		uint64_t timestamp) {
+	uint8_t record[16];
+	put32(&record[0], timestamp / 1000000000ULL);
+	put32(&record[4], (timestamp % 1000000000ULL) / 1000);
+	put32(&record[8], length);
+	put32(&record[12], length);
+	if (fwrite(record, sizeof(record), 1, writer->file) != 1
+			|| fwrite(data, 1, length, writer->file) != length) {
+		return -1;
+	}
+	return 0;
+}
+
+int pcapWritePacket(PCAPWRITER_PTR writer, PACKET_PTR packet,
+		uint64_t timestamp) {
+	return pcapWrite(writer, packet->data, packet->control.dataoffset,
+			timestamp);
+}
+
+int pcapCloseWriter(PCAPWRITER_PTR writer) {
+	int result = 0;
+	if (writer->file) {
+		result = ferror(writer->file) ? -1 : 0;
+		if (fclose(writer->file)) {
+			result = -1;
+		}
+	}
+	writer->file = NULL;
+	return result;
+}
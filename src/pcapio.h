@@ -0,0 +1,131 @@
+/**
+ * \file
+ * \brief reading and writing of pcap and pcapng captures
+ *
+ * The reader maps the whole capture into memory (on POSIX hosts, elsewhere it is read into one buffer)
+ * and yields FRAMEVIEWs that point into the mapping, so frames go to setHTIPview() and parseLLDP() or
+ * to parseLLDPBatch() without being copied. Only ethernet frames with the LLDP ethertype (0x88CC) are
+ * returned. Both pcap (microsecond and nanosecond) and pcapng (any byte order, several sections and
+ * interfaces) captures are supported.
+ *
+ * The writer produces classic pcap files with an ethernet link type, which Wireshark and tcpdump open.
+ */
+#ifndef __PCAPIO_H
+#define __PCAPIO_H
+
+#include <stdio.h>
+#include "structs.h"
+
+/** most pcapng interfaces a section may describe, frames of interfaces past this are skipped */
+#define PCAP_MAXINTERFACES 16
+
+/** capture formats */
+typedef enum {
+	PCAP_FORMAT_PCAP, /*!< classic libpcap format */
+	PCAP_FORMAT_PCAPNG /*!< pcap next generation format */
+} PCAPFORMAT;
+
+/**
+ * A capture opened for reading with pcapOpen()
+ */
+typedef struct {
+	const uint8_t * data; /*!< the whole capture */
+	size_t size; /*!< size of the capture in bytes */
+	size_t offset; /*!< offset of the next record or block */
+	PCAPFORMAT format; /*!< format of the capture */
+	int bigEndian; /*!< non-zero if the current section was written big endian */
+	uint32_t interfaces; /*!< number of interfaces of the current pcapng section (1 for pcap) */
+	uint16_t linkType[PCAP_MAXINTERFACES]; /*!< link type of each interface */
+	uint8_t resolution[PCAP_MAXINTERFACES]; /*!< timestamp resolution of each interface, as in if_tsresol */
+} PCAPREADER, *PCAPREADER_PTR;
+
+/**
+ * A frame read from a capture
+ */
+typedef struct {
+	FRAMEVIEW frame; /*!< the captured bytes, pointing into the capture */
+	uint64_t timestamp; /*!< capture time in nanoseconds since the epoch */
+	uint32_t originalLength; /*!< length of the frame on the wire, may exceed frame.length */
+	uint32_t interface; /*!< pcapng interface the frame was captured on, 0 for pcap */
+} PCAPFRAME, *PCAPFRAME_PTR;
+
+/**
+ * A capture opened for writing with pcapCreate()
+ */
+typedef struct {
+	FILE * file; /*!< the output file */
+} PCAPWRITER, *PCAPWRITER_PTR;
+
+/**
+ * Opens a capture for reading
+ * @param reader the reader to initialize
+ * @param path the capture file
+ * @return 0 on success, -1 if the file cannot be read or is not a pcap or pcapng capture
+ */
+int pcapOpen(PCAPREADER_PTR reader, const char * path);
+/**
+ * Gets the next LLDP frame of a capture
+ * @param reader an open reader
+ * @param frame filled in with the frame, valid until pcapClose()
+ * @return 1 if a frame was read, 0 at the end of the capture, -1 if the capture is malformed
+ */
+int pcapNext(PCAPREADER_PTR reader, PCAPFRAME_PTR frame);
+/**
+ * Gets up to count LLDP frames of a capture, for parseLLDPBatch()
+ * @param reader an open reader
+ * @param frames filled in with the frames, valid until pcapClose()
+ * @param count the size of the frames array
+ * @return the number of frames read, less than count at the end of the capture or if it is malformed
+ */
+size_t pcapNextBatch(PCAPREADER_PTR reader, FRAMEVIEW * frames, size_t count);
+/**
+ * Parses the next LLDP frame of a capture. The payload borrows the frame (see setHTIPview()).
+ * @param reader an open reader
+ * @param htip a payload zeroed before its first use and reset with resetHTIP() between frames, release it
+ * with releaseHTIP() or freeHTIP() when done
+ * @param want the fields to decode (see parseLLDPSelective()), PARSE_WANT_ALL for everything
+ * @return 1 if a frame was parsed (check htip->parseError), 0 at the end of the capture, -1 if the
+ * capture is malformed
+ */
+int pcapParseNext(PCAPREADER_PTR reader, HTIPPAYLOAD_PTR htip,
+		PARSEMASK want);
+/**
+ * Closes a capture. Frames read from it become invalid.
+ * @param reader the reader to close
+ */
+void pcapClose(PCAPREADER_PTR reader);
+
+/**
+ * Creates a pcap capture, overwriting the file if it exists
+ * @param writer the writer to initialize
+ * @param path the capture file
+ * @return 0 on success, -1 if the file cannot be created
+ */
+int pcapCreate(PCAPWRITER_PTR writer, const char * path);
+/**
+ * Appends a frame to a capture
+ * @param writer an open writer
+ * @param data the frame, starting at the ethernet header
+ * @param length the length of the frame
+ * @param timestamp capture time in nanoseconds since the epoch (stored with microsecond resolution)
+ * @return 0 on success, -1 on a write error
+ */
+int pcapWrite(PCAPWRITER_PTR writer, const uint8_t * data, size_t length,
+		uint64_t timestamp);
+/**
+ * Appends a packet built with the packetbuild functions (e.g. generateHtipFrame()) to a capture
+ * @param writer an open writer
+ * @param packet the packet to write
+ * @param timestamp capture time in nanoseconds since the epoch
+ * @return 0 on success, -1 on a write error
+ */
+int pcapWritePacket(PCAPWRITER_PTR writer, PACKET_PTR packet,
+		uint64_t timestamp);
+/**
+ * Flushes and closes a capture
+ * @param writer the writer to close
+ * @return 0 on success, -1 if a write error occurred
+ */
+int pcapCloseWriter(PCAPWRITER_PTR writer);
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * \file
+ * \brief platform abstraction used by the l2 agent
+ *
+ * The agent only needs to enumerate interfaces, keep time and send frames. Each platform implements the
+ * functions below in its own file:
+ * - platformlwip.c for lwIP/FreeRTOS targets (HTIP_PLATFORM_LWIP)
+ * - platformposix.c for Linux hosts, with raw packet sockets and sendmmsg() (HTIP_PLATFORM_POSIX)
+ *
+ * The platform is picked from the compiler target unless one of the two is defined.
+ */
+#ifndef __PLATFORM_H
+#define __PLATFORM_H
+
+#include "structs.h"
+
+#if !defined(HTIP_PLATFORM_LWIP) && !defined(HTIP_PLATFORM_POSIX)
+#ifdef __linux__
+#define HTIP_PLATFORM_POSIX
+#else
+#define HTIP_PLATFORM_LWIP
+#endif
+#endif
+
+//byte order conversion (htons() and friends) for the frame builder
+#ifdef HTIP_PLATFORM_LWIP
+#include <lwip/def.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+/** timeout of platformWait() that never expires */
+#define PLATFORM_WAIT_FOREVER 0xFFFFFFFF
+
+/** longest interface name kept, including the terminating NUL */
+#define PLATFORM_NAMESIZE 16
+
+/**
+ * An interface as seen by the agent
+ */
+typedef struct {
+	void * handle; /*!< platform interface, the struct netif on lwIP */
+	int index; /*!< platform interface index, the kernel ifindex on POSIX */
+	uint8_t hwaddr[6]; /*!< mac address of the interface */
+	char name[PLATFORM_NAMESIZE]; /*!< name of the interface, used as the LLDP port id */
+	size_t nameLength; /*!< number of name bytes advertised in the port id */
+	uint8_t up; /*!< non-zero if the interface is up, has a link and does broadcasting */
+} PLATFORMIFACE, *PLATFORMIFACE_PTR;
+
+/**
+ * A frame to be sent repeat times on an interface
+ */
+typedef struct {
+	PLATFORMIFACE_PTR iface; /*!< the interface to send on */
+	PACKET_PTR packet; /*!< the frame, including the ethernet header */
+	uint8_t repeat; /*!< number of times the frame is sent */
+} TXREQUEST, *TXREQUEST_PTR;
+
+/**
+ * Prepares the platform for sending, must be called before the other functions
+ * @return 0 on success, -1 on failure
+ */
+int platformInit(void);
+/**
+ * Lists the interfaces of the host
+ * @param ifaces filled in with the interfaces
+ * @param max the size of the ifaces array
+ * @return the number of interfaces listed
+ */
+size_t platformInterfaces(PLATFORMIFACE_PTR ifaces, size_t max);
+/**
+ * Gets a monotonic time
+ * @return milliseconds since an arbitrary point, wraps around
+ */
+uint32_t platformNow(void);
+/**
+ * Sleeps
+ * @param milliseconds how long to sleep
+ */
+void platformSleep(uint32_t milliseconds);
+/**
+ * Sleeps until the timeout expires or platformWake() is called, whichever comes first
+ * @param milliseconds how long to sleep at most, PLATFORM_WAIT_FOREVER for no timeout
+ * @return the event bits passed to platformWake() since the last call, 0 on timeout
+ */
+uint32_t platformWait(uint32_t milliseconds);
+/**
+ * Wakes up platformWait(). Safe to call from any task or thread, but not from an interrupt handler.
+ * @param events bits that are or'ed into the value platformWait() returns, must not be 0
+ */
+void platformWake(uint32_t events);
+/**
+ * Sends frames, batching them as much as the platform allows
+ * @param requests the frames to send
+ * @param count the number of requests
+ * @return the number of frames sent (repeats included), -1 if nothing could be sent
+ */
+int platformSend(TXREQUEST_PTR requests, size_t count);
+
+#endif
@@ -0,0 +1,112 @@
+#include "platform.h"
+
+#ifdef HTIP_PLATFORM_LWIP
+
+#include <string.h>
+#include <lwip/opt.h>
+#include <lwip/tcpip.h>
+#include <lwip/netif.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+/** the task that waits in platformWait(), woken with task notifications */
+static TaskHandle_t agentTask;
+
+#define NETFLAGS (NETIF_FLAG_UP | NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP | NETIF_FLAG_ETHARP)
+
+/**
+ * Sends a frame repeat times with one PBUF_REF pbuf. The TCPIP core lock must be held.
+ * @return the number of frames the driver accepted
+ */
+static int sendLocked(struct netif * netif, PACKET_PTR packet, int repeat,
+		err_t * result) {
+	int sent = 0;
+	struct pbuf * lowpacket = pbuf_alloc(PBUF_RAW_TX,
+			packet->control.dataoffset, PBUF_REF);
+	if (lowpacket == NULL) {
+		*result = ERR_MEM;
+		return 0;
+	}
+	lowpacket->payload = packet->data;
+	for (int i = 0; i < repeat; i++) {
+		*result = netif->linkoutput(netif, lowpacket);
+		if (*result == ERR_OK) {
+			sent++;
+		}
+	}
+	pbuf_free(lowpacket);
+	return sent;
+}
+
+/**
+ * This is what I think should be an ideal just-send-the-packet
+ * type of function.
+ */
+err_t iface_send(struct netif *netif, PACKET_PTR packet) {
+	err_t result = ERR_OK;
+	LOCK_TCPIP_CORE();
+	sendLocked(netif, packet, 1, &result);
+	UNLOCK_TCPIP_CORE();
+	return result;
+}
+
+int platformInit(void) {
+	agentTask = xTaskGetCurrentTaskHandle();
+	return netif_default == NULL ? -1 : 0;
+}
+
+size_t platformInterfaces(PLATFORMIFACE_PTR ifaces, size_t max) {
+	size_t count = 0;
+	//the default interface comes first, its mac is the chasis id
+	for (struct netif * iface = netif_default; iface != NULL && count < max;
+			iface = iface->next) {
+		PLATFORMIFACE_PTR out = &ifaces[count++];
+		out->handle = iface;
+		out->index = iface->num;
+		memcpy(out->hwaddr, iface->hwaddr, 6);
+		memcpy(out->name, iface->name, sizeof(iface->name));
+		out->name[sizeof(iface->name)] = 0;
+		out->nameLength = sizeof(iface->name);
+		//check that we have an ethernet device that uses arp, its up, linkup and does broadcasting
+		out->up = NETFLAGS == (iface->flags & NETFLAGS);
+	}
+	return count;
+}
+
+uint32_t platformNow(void) {
+	return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+void platformSleep(uint32_t milliseconds) {
+	vTaskDelay(milliseconds / portTICK_PERIOD_MS);
+}
+
+uint32_t platformWait(uint32_t milliseconds) {
+	uint32_t events = 0;
+	TickType_t ticks =
+			milliseconds == PLATFORM_WAIT_FOREVER ?
+					portMAX_DELAY : milliseconds / portTICK_PERIOD_MS;
+	xTaskNotifyWait(0, 0xFFFFFFFF, &events, ticks);
+	return events;
+}
+
+void platformWake(uint32_t events) {
+	if (agentTask) {
+		xTaskNotify(agentTask, events, eSetBits);
+	}
+}
+
+int platformSend(TXREQUEST_PTR requests, size_t count) {
+	int sent = 0;
+	err_t result = ERR_OK;
+	//one lock for the whole batch, one pbuf per frame however many times it is sent
+	LOCK_TCPIP_CORE();
+	for (size_t i = 0; i < count; i++) {
+		sent += sendLocked(requests[i].iface->handle, requests[i].packet,
+				requests[i].repeat, &result);
+	}
+	UNLOCK_TCPIP_CORE();
+	return count && sent == 0 ? -1 : sent;
+}
+
+#endif
@@ -0,0 +1,181 @@
+//sendmmsg()
+#define _GNU_SOURCE
+#include "platform.h"
+
+#ifdef HTIP_PLATFORM_POSIX
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+/** most frames handed to one sendmmsg() call */
+#define PLATFORM_TXBATCH 64
+
+/** the send-only packet socket shared by every interface */
+static int txSocket = -1;
+
+/** wakes up platformWait(), pending holds the events of platformWake() */
+static pthread_mutex_t wakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeCondition = PTHREAD_COND_INITIALIZER;
+static uint32_t pending;
+
+int platformInit(void) {
+	if (txSocket < 0) {
+		pthread_condattr_t attributes;
+		pthread_condattr_init(&attributes);
+		//deadlines come from platformNow(), don't let wall clock changes move them
+		pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+		pthread_mutex_lock(&wakeLock);
+		pthread_cond_destroy(&wakeCondition);
+		pthread_cond_init(&wakeCondition, &attributes);
+		pthread_mutex_unlock(&wakeLock);
+		pthread_condattr_destroy(&attributes);
+		//protocol 0: the socket never receives anything
+		txSocket = socket(AF_PACKET, SOCK_RAW, 0);
+	}
+	return txSocket < 0 ? -1 : 0;
+}
+
+size_t platformInterfaces(PLATFORMIFACE_PTR ifaces, size_t max) {
+	struct ifaddrs * addrs;
+	size_t count = 0;
+	if (getifaddrs(&addrs)) {
+		return 0;
+	}
+	for (struct ifaddrs * addr = addrs; addr != NULL && count < max; addr =
+			addr->ifa_next) {
+		struct sockaddr_ll * link = (struct sockaddr_ll *) addr->ifa_addr;
+		if (link == NULL || link->sll_family != AF_PACKET
+				|| link->sll_halen != 6
+				|| (addr->ifa_flags & IFF_LOOPBACK)) {
+			continue;
+		}
+		PLATFORMIFACE_PTR out = &ifaces[count++];
+		out->handle = NULL;
+		out->index = link->sll_ifindex;
+		memcpy(out->hwaddr, link->sll_addr, 6);
+		strncpy(out->name, addr->ifa_name, PLATFORM_NAMESIZE - 1);
+		out->name[PLATFORM_NAMESIZE - 1] = 0;
+		out->nameLength = strlen(out->name);
+		out->up = (addr->ifa_flags & (IFF_UP | IFF_RUNNING | IFF_BROADCAST))
+				== (IFF_UP | IFF_RUNNING | IFF_BROADCAST);
+	}
+	freeifaddrs(addrs);
+	return count;
+}
+
+uint32_t platformNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void platformSleep(uint32_t milliseconds) {
+	struct timespec delay = { milliseconds / 1000, (milliseconds % 1000)
+			* 1000000L };
+	while (nanosleep(&delay, &delay) && errno == EINTR) {
+		//interrupted, sleep for the rest
+	}
+}
+
+uint32_t platformWait(uint32_t milliseconds) {
+	struct timespec deadline;
+	uint32_t events;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (milliseconds % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&wakeLock);
+	while (pending == 0) {
+		if (milliseconds == PLATFORM_WAIT_FOREVER) {
+			pthread_cond_wait(&wakeCondition, &wakeLock);
+		} else if (pthread_cond_timedwait(&wakeCondition, &wakeLock,
+				&deadline)) {
+			break;
+		}
+	}
+	events = pending;
+	pending = 0;
+	pthread_mutex_unlock(&wakeLock);
+	return events;
+}
+
+void platformWake(uint32_t events) {
+	pthread_mutex_lock(&wakeLock);
+	pending |= events;
+	pthread_cond_signal(&wakeCondition);
+	pthread_mutex_unlock(&wakeLock);
+}
+
+int platformSend(TXREQUEST_PTR requests, size_t count) {
+	struct mmsghdr messages[PLATFORM_TXBATCH];
+	struct iovec vectors[PLATFORM_TXBATCH];
+	struct sockaddr_ll addresses[PLATFORM_TXBATCH];
+	int sent = 0;
+	int failed = 0;
+	size_t queued = 0;
+	size_t request = 0;
+	int repeat = 0;
+	if (txSocket < 0) {
+		return -1;
+	}
+	while (request < count || queued) {
+		//fill the batch with the remaining frames, one message per repeat
+		while (request < count && queued < PLATFORM_TXBATCH) {
+			TXREQUEST_PTR tx = &requests[request];
+			if (repeat >= tx->repeat) {
+				request++;
+				repeat = 0;
+				continue;
+			}
+			struct sockaddr_ll * address = &addresses[queued];
+			memset(address, 0, sizeof(struct sockaddr_ll));
+			address->sll_family = AF_PACKET;
+			address->sll_ifindex = tx->iface->index;
+			address->sll_halen = 6;
+			memcpy(address->sll_addr, tx->packet->data, 6);
+			vectors[queued].iov_base = tx->packet->data;
+			vectors[queued].iov_len = tx->packet->control.dataoffset;
+			memset(&messages[queued], 0, sizeof(struct mmsghdr));
+			messages[queued].msg_hdr.msg_name = address;
+			messages[queued].msg_hdr.msg_namelen = sizeof(struct sockaddr_ll);
+			messages[queued].msg_hdr.msg_iov = &vectors[queued];
+			messages[queued].msg_hdr.msg_iovlen = 1;
+			queued++;
+			repeat++;
+		}
+		if (queued == 0) {
+			break;
+		}
+		int done = sendmmsg(txSocket, messages, queued, 0);
+		if (done <= 0) {
+			//skip the frame that failed (e.g. the interface went down)
+			done = 1;
+			failed++;
+		} else {
+			sent += done;
+		}
+		//move what is left to the front of the batch
+		queued -= done;
+		memmove(messages, &messages[done], queued * sizeof(struct mmsghdr));
+		memmove(vectors, &vectors[done], queued * sizeof(struct iovec));
+		memmove(addresses, &addresses[done],
+				queued * sizeof(struct sockaddr_ll));
+		for (size_t i = 0; i < queued; i++) {
+			messages[i].msg_hdr.msg_name = &addresses[i];
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+		}
+	}
+	return sent == 0 && failed ? -1 : sent;
+}
+
+#endif
@@ -26,8 +26,14 @@ typedef struct {
 	size_t allocated; /*!< allocated bytes for this packet */
 	size_t used; /*!< .. i don't think this is used.. */
 	size_t dataoffset; /*!<data offset. data will be written in this offset. Doubles as packet size indicator */
+	uint8_t flags; /*!< PACKET_FLAG_* bits */
 } PACKETCONTROL;
 
+/** the data buffer was allocated separately from the PACKET and must be freed with it */
+#define PACKET_FLAG_EXTERNAL 0x01
+/** a write did not fit in the packet and was dropped, the frame must not be sent */
+#define PACKET_FLAG_OVERFLOW 0x02
+
 /**
  * The main data structure representing a datalink frame.
  */
@@ -36,6 +42,24 @@ typedef struct {
 	uint8_t * data; /*!< actual pointer to the underlying buffer */
 } PACKET, *PACKET_PTR;
 
+/**
+ * A prebuilt frame along with the offsets of the fields that may change between two sends.
+ * An offset of 0 means that the field is not part of the template.
+ */
+typedef struct {
+	PACKET_PTR packet; /*!< the prebuilt frame */
+	size_t srcOffset; /*!< offset of the ethernet source mac address (6 bytes) */
+	size_t portIdOffset; /*!< offset of the LLDP port id, right after the port id type */
+	size_t portIdLength; /*!< length of the LLDP port id */
+	size_t ttlOffset; /*!< offset of the LLDP Time To Live (2 bytes) */
+	size_t channelUseStateOffset; /*!< offset of the HTIP channel use state value (1.20) */
+	size_t signalStrengthOffset; /*!< offset of the HTIP signal strength value (1.21) */
+	size_t communicationErrorOffset; /*!< offset of the HTIP communication error value (1.22) */
+	size_t statusOffset; /*!< offset of the HTIP status information data (1.50) */
+	size_t statusLength; /*!< length of the HTIP status information data */
+	size_t sendIntervalOffset; /*!< offset of the HTIP lldpdu send interval (1.80, 2 bytes) */
+} HTIPTEMPLATE, *HTIPTEMPLATE_PTR;
+
 /**
  * A TLV structure used during creation and parsing of TLV values
  */
@@ -49,6 +73,15 @@ typedef struct {
 	size_t datastart;
 } TLV, *TLV_PTR;
 
+/**
+ * A non-allocating cursor that walks the TLVs of a borrowed buffer
+ */
+typedef struct {
+	const uint8_t * data; /*!< start of the first TLV, borrowed and never freed */
+	size_t length; /*!< number of bytes available in data */
+	size_t next; /*!< offset of the next TLV to be read */
+} TLVCURSOR, *TLVCURSOR_PTR;
+
 /**
  * A generic structure for keeping information about a parsed TLV
  */
@@ -70,8 +103,71 @@ typedef struct {
 	uint8_t * macs; /*!<raw data that will be used for as mac addresses. for each 6 bytes macLength should increase by 1 */
 } MACFTLV, *MACFTLV_PTR;
 
-/** maximum number of ports in a mac forwarding table */
-#define MAXPORTS 64
+/**
+ * A host of an HTIP extended connectivity TLV
+ */
+typedef struct {
+	const uint8_t * mac; /*!< mac address of the host, EXTCONNECTIVITY::macLength bytes inside the frame */
+	int16_t signalStrength; /*!< signal strength (0-100), -1 if not reported */
+	int16_t errorRate; /*!< communication error percentage (0-100), -1 if not reported */
+	uint16_t port; /*!< index of the port of the host in HTIPPAYLOAD::connectivity */
+} EXTHOST, *EXTHOST_PTR;
+
+/**
+ * A decoded HTIP extended connectivity TLV (subtype 4): a port of the agent and the hosts connected to it.
+ * Addresses and channel usage point into the frame, the hosts are kept in a single block.
+ */
+typedef struct {
+	INFOPIECE raw; /*!< raw information of the port, starting at the port length, acount is the number of hosts */
+	uint32_t portNumber; /*!< the port the hosts are connected to */
+	uint8_t macLength; /*!< length of every mac address of the TLV */
+	uint8_t hostCount; /*!< number of entries in hosts */
+	uint8_t pairedCount; /*!< number of addresses in pairedMacs */
+	uint8_t channelCount; /*!< number of bytes in channelUsage */
+	EXTHOST_PTR hosts; /*!< the hosts, in frame order */
+	const uint8_t * pairedMacs; /*!< mac addresses paired with the port, macLength bytes each */
+	const uint8_t * channelUsage; /*!< channel usage of the port, one byte per channel */
+} EXTCONNECTIVITY, *EXTCONNECTIVITY_PTR;
+
+/**
+ * A borrowed view of a received frame, starting at the ethernet header
+ */
+typedef struct {
+	const uint8_t * data; /*!< start of the frame */
+	size_t length; /*!< length of the frame */
+} FRAMEVIEW, *FRAMEVIEW_PTR;
+
+/**
+ * The value of a single TLV as decoded by decodeTLV(), before it is stored anywhere
+ */
+typedef struct {
+	uint8_t subtype; /*!< HTIP subtype of a TTC type 127 TLV, 0 for every other TLV */
+	INFOPIECE piece; /*!< the value. acount is the id subtype for types 1 and 2, the ttl for type 3 and the device
+	 information type for HTIP subtype 1 */
+	MACFTLV macftlv; /*!< the forwarding table port of HTIP subtype 2 */
+} TLVVALUE, *TLVVALUE_PTR;
+
+/**
+ * Reasons for which a frame can fail to parse. Stored in HTIPPAYLOAD::parseError.
+ */
+typedef enum {
+	PARSE_OK = 0, /*!< the frame parsed successfully */
+	PARSE_ERR_NO_DATA, /*!< the frame is shorter than an ethernet header */
+	PARSE_ERR_TLV_HEADER, /*!< a TLV header is cut off by the end of the frame */
+	PARSE_ERR_TLV_LENGTH, /*!< a TLV length runs past the end of the frame */
+	PARSE_ERR_TLV_TOO_SHORT, /*!< a TLV is shorter than the minimum length of its type */
+	PARSE_ERR_FIELD_LENGTH, /*!< a field inside a TLV runs past the end of the TLV */
+	PARSE_ERR_FIELD_VALUE, /*!< a field inside a TLV has an unsupported value (e.g. a 3-byte port number) */
+	PARSE_ERR_UNKNOWN_TLV, /*!< a reserved TLV type (9-126) was found */
+	PARSE_ERR_NO_END, /*!< the frame ended without an End Of LLDPDU TLV */
+	PARSE_ERR_NO_MEMORY /*!< the arena of the payload could not be allocated */
+} PARSEERROR;
+
+/**
+ * A set of PARSE_WANT_* bits telling parseLLDPSelective() which fields to decode
+ */
+typedef uint32_t PARSEMASK;
+
 /**
  * The core structure that holds data of a parsed LLDP/HTIP frame. See details for each field.
  */
@@ -79,8 +175,12 @@ typedef struct {
 	uint8_t datalinkType; /*!< to support various datalink layers. also the pointer in sfptrs*/
 	uint32_t recvTime; /*!< relative time this frame was received, in SECONDS */
 	PACKET packet; /*!< original frame that was parsed */
+	uint8_t * arena; /*!< the only allocation of the payload: the frame copy, the forwarding table ports and the extended connectivity */
+	size_t arenaSize; /*!< bytes of the arena in use */
+	size_t arenaCapacity; /*!< bytes allocated for the arena, resetHTIP() keeps them for the next frame */
 	INFOPIECE src; /*!< mac address from which this HTIP frame originated */
-	INFOPIECE parseResult; /*!< parse result */
+	INFOPIECE parseResult; /*!< parse result. acount is 1 on success, on failure info points to the offending TLV */
+	PARSEERROR parseError; /*!< the reason the parse failed, PARSE_OK on success */
 	INFOPIECE chasisId; /*!< LLDP chasis id (type 1) */
 	INFOPIECE portId; /*!< LLDP port id (type 2) */
 	INFOPIECE ttl; /*!< LLDP Time To Live (type 3) */
@@ -91,7 +191,12 @@ typedef struct {
 	INFOPIECE modelNumber; /*!< HTIP model number (type 127, htip sub/dev.inf: 1/4 */
 	INFOPIECE macs; /*!< Mac addresses for this HTIP agent (type 127, htip sub/dev.inf: 3/1 */
 	INFOPIECE extMacs; /*!< Extended Mac addresses  (type 127, htip sub/dev.inf: 5/1 */
-	MACFTLV_PTR macftlvs[MAXPORTS]; /*!< Mac forwarding table (type 127, htip sub/dev.inf: 2/1 */
+	EXTCONNECTIVITY_PTR connectivity; /*!< Extended connectivity information, connectivityCount ports in frame order (type 127, htip sub: 4) */
+	size_t connectivityCount; /*!< number of ports in connectivity */
+	size_t connectivityCapacity; /*!< number of ports connectivity has room for */
+	MACFTLV_PTR macftlvs; /*!< Mac forwarding table, portCount ports in frame order (type 127, htip sub/dev.inf: 2/1 */
+	size_t portCount; /*!< number of ports in macftlvs */
+	size_t portCapacity; /*!< number of ports macftlvs has room for, counted before the frame is parsed */
 } HTIPPAYLOAD, *HTIPPAYLOAD_PTR;
 
 #endif
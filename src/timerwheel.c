@@ -0,0 +1,136 @@
+#include <stddef.h>
+#include "timerwheel.h"
+
+/** distance between two times that copes with the clock wrapping around */
+#define ELAPSED(from, to) ((int32_t) ((to) - (from)))
+
+static void listInit(TIMERNODE_PTR head) {
+	head->next = head;
+	head->prev = head;
+}
+
+static void listAppend(TIMERNODE_PTR head, TIMERNODE_PTR node) {
+	node->prev = head->prev;
+	node->next = head;
+	head->prev->next = node;
+	head->prev = node;
+}
+
+static void listUnlink(TIMERNODE_PTR node) {
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->next = NULL;
+	node->prev = NULL;
+}
+
+/**
+ * puts a node in the slot matching its deadline. The first level covers the 256 ticks starting
+ * with the next one to be processed, the second level covers the 256-tick blocks after that.
+ */
+static void place(TIMERWHEEL_PTR wheel, TIMERNODE_PTR node) {
+	uint32_t base = wheel->now + 1;
+	uint32_t deadline = node->deadline;
+	if (ELAPSED(base, deadline) < 0) {
+		//already due, fire on the next tick
+		deadline = base;
+	}
+	if (ELAPSED(base, deadline) < TIMERWHEEL_SLOTS) {
+		listAppend(&wheel->seconds[deadline & 0xFF], node);
+		return;
+	}
+	if ((deadline >> 8) - (base >> 8) >= TIMERWHEEL_SLOTS) {
+		//further than the wheel reaches, park in the last block and place again when it cascades
+		deadline = base + ((TIMERWHEEL_SLOTS - 1) << 8);
+	}
+	listAppend(&wheel->minutes[(deadline >> 8) & 0xFF], node);
+}
+
+/** moves every node of a list to the slots matching the current time */
+static void replace(TIMERWHEEL_PTR wheel, TIMERNODE_PTR head) {
+	TIMERNODE_PTR node = head->next;
+	listInit(head);
+	while (node != head) {
+		TIMERNODE_PTR next = node->next;
+		place(wheel, node);
+		node = next;
+	}
+}
+
+void timerWheelInit(TIMERWHEEL_PTR wheel, uint32_t now) {
+	for (int i = 0; i < TIMERWHEEL_SLOTS; i++) {
+		listInit(&wheel->seconds[i]);
+		listInit(&wheel->minutes[i]);
+	}
+	wheel->now = now;
+	wheel->count = 0;
+}
+
+void timerWheelSchedule(TIMERWHEEL_PTR wheel, TIMERNODE_PTR node,
+		uint32_t deadline) {
+	if (node->next) {
+		listUnlink(node);
+	} else {
+		wheel->count++;
+	}
+	node->deadline = deadline;
+	place(wheel, node);
+}
+
+void timerWheelCancel(TIMERWHEEL_PTR wheel, TIMERNODE_PTR node) {
+	if (node->next) {
+		listUnlink(node);
+		wheel->count--;
+	}
+}
+
+size_t timerWheelAdvance(TIMERWHEEL_PTR wheel, uint32_t now,
+		TIMERCALLBACK callback, void * context) {
+	TIMERNODE_PTR batch[TIMERWHEEL_BATCH];
+	size_t count = 0;
+	size_t total = 0;
+	if (ELAPSED(wheel->now, now) > TIMERWHEEL_SLOTS * TIMERWHEEL_SLOTS) {
+		//a jump longer than the wheel, sort everything out relative to the new time in one go
+		wheel->now = now - 1;
+		for (int i = 0; i < TIMERWHEEL_SLOTS; i++) {
+			replace(wheel, &wheel->minutes[i]);
+			replace(wheel, &wheel->seconds[i]);
+		}
+	}
+	while (ELAPSED(wheel->now, now) > 0) {
+		uint32_t tick = wheel->now + 1;
+		if ((tick & 0xFF) == 0) {
+			//a new block starts, spread its timers over the first level
+			replace(wheel, &wheel->minutes[(tick >> 8) & 0xFF]);
+		}
+		//everything in the slot of this tick is due, take the whole list out of the wheel first.
+		//the expired nodes stay chained through prev only, so they already look unscheduled
+		TIMERNODE_PTR head = &wheel->seconds[tick & 0xFF];
+		TIMERNODE_PTR expired = NULL;
+		for (TIMERNODE_PTR node = head->prev; node != head;) {
+			TIMERNODE_PTR prev = node->prev;
+			node->next = NULL;
+			node->prev = expired;
+			expired = node;
+			wheel->count--;
+			node = prev;
+		}
+		listInit(head);
+		wheel->now = tick;
+		while (expired) {
+			TIMERNODE_PTR node = expired;
+			expired = node->prev;
+			node->prev = NULL;
+			batch[count++] = node;
+			if (count == TIMERWHEEL_BATCH) {
+				callback(context, batch, count);
+				total += count;
+				count = 0;
+			}
+		}
+	}
+	if (count) {
+		callback(context, batch, count);
+		total += count;
+	}
+	return total;
+}
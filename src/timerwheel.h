@@ -0,0 +1,85 @@
+/**
+ * \file
+ * \brief hierarchical timer wheel for expiring neighbors
+ *
+ * Two levels of 256 slots: the first level holds timers due in the next 256 seconds with a
+ * resolution of one second, the second level holds timers due up to 65536 seconds away (the
+ * largest LLDP TTL) with a resolution of 256 seconds, cascading into the first level as time
+ * passes. Scheduling, rescheduling and cancelling are O(1), and advancing the wheel only touches
+ * the timers that actually expire.
+ */
+#ifndef __TIMERWHEEL_H
+#define __TIMERWHEEL_H
+
+#include "structs.h"
+
+/** number of slots of each wheel level, must be 256 */
+#define TIMERWHEEL_SLOTS 256
+/** maximum number of timers handed to the callback in a single call */
+#define TIMERWHEEL_BATCH 64
+
+/**
+ * A timer. Embed it in, or allocate it along with, the object that expires.
+ */
+typedef struct TIMERNODE {
+	struct TIMERNODE * next; /*!< next timer in the slot, NULL if the timer is not scheduled */
+	struct TIMERNODE * prev; /*!< previous timer in the slot */
+	uint32_t deadline; /*!< time this timer expires, in SECONDS */
+	uint64_t key; /*!< free for the user, identifies the expiring object */
+} TIMERNODE, *TIMERNODE_PTR;
+
+/**
+ * The timer wheel, initialize it with timerWheelInit()
+ */
+typedef struct {
+	TIMERNODE seconds[TIMERWHEEL_SLOTS]; /*!< first level, list heads of one-second slots */
+	TIMERNODE minutes[TIMERWHEEL_SLOTS]; /*!< second level, list heads of 256-second slots */
+	uint32_t now; /*!< the time the wheel has been advanced to */
+	size_t count; /*!< number of scheduled timers */
+} TIMERWHEEL, *TIMERWHEEL_PTR;
+
+/**
+ * Receives a batch of expired timers. The timers are no longer scheduled and may be freed or
+ * scheduled again. The callback may schedule or cancel any other timer, but must not touch
+ * expired timers it has not received yet.
+ */
+typedef void (*TIMERCALLBACK)(void * context, TIMERNODE_PTR * expired,
+		size_t count);
+
+/**
+ * Initializes an empty timer wheel
+ * @param wheel the wheel to initialize
+ * @param now the current time, in SECONDS
+ */
+void timerWheelInit(TIMERWHEEL_PTR wheel, uint32_t now);
+
+/**
+ * Schedules a timer, or moves it if it is already scheduled. Deadlines that already passed fire
+ * on the next advance.
+ * @param wheel the timer wheel
+ * @param node the timer
+ * @param deadline the time the timer expires, in SECONDS
+ */
+void timerWheelSchedule(TIMERWHEEL_PTR wheel, TIMERNODE_PTR node,
+		uint32_t deadline);
+
+/**
+ * Cancels a timer. Does nothing if the timer is not scheduled.
+ * @param wheel the timer wheel
+ * @param node the timer
+ */
+void timerWheelCancel(TIMERWHEEL_PTR wheel, TIMERNODE_PTR node);
+
+/**
+ * Advances the wheel and fires every timer whose deadline is not later than now, in batches
+ * of up to TIMERWHEEL_BATCH timers.
+ * @param wheel the timer wheel
+ * @param now the current time, in SECONDS
+ * @param callback called with every batch of expired timers
+ * @param context passed to the callback
+ * @return the number of timers that expired
+ */
+size_t timerWheelAdvance(TIMERWHEEL_PTR wheel, uint32_t now,
+		TIMERCALLBACK callback, void * context);
+
+#endif